@@ -0,0 +1,62 @@
+#shader vertex
+#version 330 core
+// Evaluates the Bezier board once per tick, output is captured with transform feedback
+// into the stream drawn by the BEZIER_STREAM variant of Phong.shader (no fragment stage, rasterizer is off)
+layout(location = 0) in vec2 surfaceCoord;
+// (u, v) of both ends of the coarser edge the vertex morphs onto and the two tiles morphing it, -1 - none
+layout(location = 1) in vec4 morphEnds;
+layout(location = 2) in vec2 morphTiles;
+
+// control points heights, u_ControlPoints[i][j] is the point i along x and j along z
+uniform vec4 u_ControlPoints[4];
+// 0 - tile at its own level, 1 - looks like its next coarser level
+uniform float u_TileMorph[64];
+
+// height and its derivatives along x and z
+out vec3 tf_HeightSlope;
+
+vec4 Bernstein(float t)
+{
+	float s = 1.0 - t;
+	return vec4(s * s * s, 3.0 * t * s * s, 3.0 * t * t * s, t * t * t);
+}
+
+// degree lowered by one and multiplied by degree
+vec3 BernsteinDerivative(float t)
+{
+	float s = 1.0 - t;
+	return vec3(3.0 * s * s, 6.0 * t * s, 3.0 * t * t);
+}
+
+// height and its derivatives along x and z at (u, v)
+vec3 EvaluateSurface(vec2 uv)
+{
+	vec4 bx = Bernstein(uv.x);
+	vec3 dbx = BernsteinDerivative(uv.x);
+	vec4 by = Bernstein(uv.y);
+	vec3 dby = BernsteinDerivative(uv.y);
+
+	// control points collapsed along x: curve in z and its x derivative
+	vec4 curve = vec4(0.0);
+	vec4 curveDx = vec4(0.0);
+	for (int i = 0; i < 4; i++)
+		curve += bx[i] * u_ControlPoints[i];
+	for (int i = 0; i < 3; i++)
+		curveDx += dbx[i] * (u_ControlPoints[i + 1] - u_ControlPoints[i]);
+
+	return vec3(dot(curve, by), dot(curveDx, by), dot(curve.yzw - curve.xyz, dby));
+}
+
+float TileMorph(float tile)
+{
+	return tile < 0.0 ? 0.0 : u_TileMorph[int(tile)];
+}
+
+void main()
+{
+	tf_HeightSlope = EvaluateSurface(surfaceCoord);
+	// blended onto the coarser edge before the tile switches to that level, like BM_CPU does on the CPU
+	float morph = max(TileMorph(morphTiles.x), TileMorph(morphTiles.y));
+	if (morph > 0.0)
+		tf_HeightSlope = mix(tf_HeightSlope, 0.5 * (EvaluateSurface(morphEnds.xy) + EvaluateSurface(morphEnds.zw)), morph);
+};
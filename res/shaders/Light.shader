@@ -9,11 +9,14 @@ out vec4 v_Color;
 // Imports the camera matrix from the main function
 uniform mat4 u_camMatrix;
 uniform mat4 u_Model;
+// position decoding of quantized meshes, see Mesh::SetDecodeUniforms
+uniform vec3 u_PositionOffset = vec3(0.0);
+uniform vec3 u_PositionScale = vec3(1.0);
 
 void main()
 {
 	v_TexCoord = texCoord;
-	gl_Position = u_camMatrix * u_Model * position;
+	gl_Position = u_camMatrix * u_Model * vec4(u_PositionOffset + position.xyz * u_PositionScale, 1.0);
 	v_Color = colorV;
 };
 
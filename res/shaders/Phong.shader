@@ -1,8 +1,52 @@
 #shader vertex
 #version 330 core
-layout(location = 0) in vec4 position;
-layout(location = 1) in vec2 texCoord;
-layout(location = 2) in vec3 normal;
+#if defined(BEZIER_PATCH)
+// the 4 x 4 control points of the patch at (i / 3, j / 3), the surface is evaluated in the tessellation stages below
+layout(location = 0) in vec2 surfaceCoord;
+
+out vec2 tc_SurfaceCoord;
+
+void main()
+{
+	tc_SurfaceCoord = surfaceCoord;
+};
+#else
+#if defined(BEZIER_SURFACE)
+// flat (u, v) grid, height and normal come from the bicubic Bezier patch below
+layout(location = 0) in vec2 surfaceCoord;
+// (u, v) of both ends of the coarser edge the vertex morphs onto and the two tiles morphing it, -1 - none
+layout(location = 1) in vec4 morphEnds;
+layout(location = 2) in vec2 morphTiles;
+
+// control points heights, u_ControlPoints[i][j] is the point i along x and j along z
+uniform vec4 u_ControlPoints[4];
+// 0 - tile at its own level, 1 - looks like its next coarser level
+uniform float u_TileMorph[64];
+#elif defined(BEZIER_STREAM)
+// flat (u, v) grid, static
+layout(location = 0) in vec2 surfaceCoord;
+// height and its derivatives along x and z, tessellated on the CPU and streamed every tick
+layout(location = 1) in vec3 heightSlope;
+#else
+layout(location = 0) in vec4 meshPosition;
+layout(location = 1) in vec2 meshTexCoord;
+#ifdef QUANTIZED_MESH
+// octahedral, see DecodeOctahedral
+layout(location = 2) in vec2 meshNormal;
+#else
+layout(location = 2) in vec3 meshNormal;
+#endif
+
+// quantized meshes store positions as fractions of their bounds, float meshes keep these defaults
+uniform vec3 u_PositionOffset = vec3(0.0);
+uniform vec3 u_PositionScale = vec3(1.0);
+
+#ifdef INSTANCED
+// one per instance (MeshInstance), in place of u_Model and u_Color
+layout(location = 3) in mat4 instanceModel;
+layout(location = 7) in vec4 instanceColor;
+#endif
+#endif
 
 out vec2 v_TexCoord;
 out vec4 v_Color;
@@ -13,13 +57,200 @@ uniform mat4 u_camMatrix;
 uniform mat4 u_Model;
 uniform vec4 u_Color;
 
+#ifdef BEZIER_SURFACE
+vec4 Bernstein(float t)
+{
+	float s = 1.0 - t;
+	return vec4(s * s * s, 3.0 * t * s * s, 3.0 * t * t * s, t * t * t);
+}
+
+// degree lowered by one and multiplied by degree
+vec3 BernsteinDerivative(float t)
+{
+	float s = 1.0 - t;
+	return vec3(3.0 * s * s, 6.0 * t * s, 3.0 * t * t);
+}
+
+// height and its derivatives along x and z at (u, v)
+vec3 EvaluateSurface(vec2 uv)
+{
+	vec4 bx = Bernstein(uv.x);
+	vec3 dbx = BernsteinDerivative(uv.x);
+	vec4 by = Bernstein(uv.y);
+	vec3 dby = BernsteinDerivative(uv.y);
+
+	// control points collapsed along x: curve in z and its x derivative
+	vec4 curve = vec4(0.0);
+	vec4 curveDx = vec4(0.0);
+	for (int i = 0; i < 4; i++)
+		curve += bx[i] * u_ControlPoints[i];
+	for (int i = 0; i < 3; i++)
+		curveDx += dbx[i] * (u_ControlPoints[i + 1] - u_ControlPoints[i]);
+
+	return vec3(dot(curve, by), dot(curveDx, by), dot(curve.yzw - curve.xyz, dby));
+}
+
+float TileMorph(float tile)
+{
+	return tile < 0.0 ? 0.0 : u_TileMorph[int(tile)];
+}
+#endif
+
+#ifdef QUANTIZED_MESH
+// unit vector from its projection on the octahedron |x| + |y| + |z| = 1, lower half unfolded over the upper one
+vec3 DecodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+#endif
+
 void main()
 {
+#ifdef BEZIER_SURFACE
+	vec3 surface = EvaluateSurface(surfaceCoord);
+	// blended onto the coarser edge before the tile switches to that level, heights and slopes
+	float morph = max(TileMorph(morphTiles.x), TileMorph(morphTiles.y));
+	if (morph > 0.0)
+		surface = mix(surface, 0.5 * (EvaluateSurface(morphEnds.xy) + EvaluateSurface(morphEnds.zw)), morph);
+
+	vec4 position = vec4(surfaceCoord.x, surface.x, surfaceCoord.y, 1.0);
+	vec2 texCoord = surfaceCoord;
+	vec3 normal = normalize(vec3(-surface.y, 1.0, -surface.z));
+#elif defined(BEZIER_STREAM)
+	vec4 position = vec4(surfaceCoord.x, heightSlope.x, surfaceCoord.y, 1.0);
+	vec2 texCoord = surfaceCoord;
+	vec3 normal = normalize(vec3(-heightSlope.y, 1.0, -heightSlope.z));
+#else
+	vec4 position = vec4(u_PositionOffset + meshPosition.xyz * u_PositionScale, 1.0);
+	vec2 texCoord = meshTexCoord;
+#ifdef QUANTIZED_MESH
+	vec3 normal = DecodeOctahedral(meshNormal);
+#else
+	vec3 normal = meshNormal;
+#endif
+#endif
+#ifdef INSTANCED
+	mat4 model = instanceModel;
+	vec4 color = instanceColor;
+#else
+	mat4 model = u_Model;
+	vec4 color = u_Color;
+#endif
 	v_TexCoord = texCoord;
+	gl_Position = u_camMatrix * model * position;
+	FragPos = vec3(model * position);
+	v_Color = color;
+	v_Normal = mat3(transpose(inverse(model))) * normal;
+};
+#endif
+
+#shader tess_control BEZIER_PATCH
+#version 400 core
+layout(vertices = 16) out;
+
+in vec2 tc_SurfaceCoord[];
+out vec2 te_SurfaceCoord[];
+
+uniform mat4 u_Model;
+uniform vec3 u_CameraPos;
+uniform vec4 u_ControlPoints[4];
+// segments per unit of edge length seen from a unit distance
+uniform float u_TessellationDensity;
+
+// corner control points lie on the surface, so the patch edges run between them
+vec3 Corner(int i, int j)
+{
+	return vec3(u_Model * vec4(i / 3.0, u_ControlPoints[i][j], j / 3.0, 1.0));
+}
+
+// level of one edge from its length and distance to the camera, neighbour patches sharing the edge get the same level
+float EdgeLevel(vec3 a, vec3 b)
+{
+	float dist = max(distance(u_CameraPos, 0.5 * (a + b)), 0.001);
+	return clamp(u_TessellationDensity * distance(a, b) / dist, 1.0, 64.0);
+}
+
+void main()
+{
+	te_SurfaceCoord[gl_InvocationID] = tc_SurfaceCoord[gl_InvocationID];
+
+	if (gl_InvocationID == 0)
+	{
+		vec3 c00 = Corner(0, 0);
+		vec3 c30 = Corner(3, 0);
+		vec3 c03 = Corner(0, 3);
+		vec3 c33 = Corner(3, 3);
+
+		// outer levels: edges u = 0, v = 0, u = 1, v = 1
+		gl_TessLevelOuter[0] = EdgeLevel(c00, c03);
+		gl_TessLevelOuter[1] = EdgeLevel(c00, c30);
+		gl_TessLevelOuter[2] = EdgeLevel(c30, c33);
+		gl_TessLevelOuter[3] = EdgeLevel(c03, c33);
+		gl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);
+		gl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);
+	}
+};
+
+#shader tess_evaluation BEZIER_PATCH
+#version 400 core
+// fractional spacing grows new vertices smoothly instead of popping when the level changes
+layout(quads, fractional_odd_spacing, ccw) in;
+
+in vec2 te_SurfaceCoord[];
+
+out vec2 v_TexCoord;
+out vec4 v_Color;
+out vec3 v_Normal;
+out vec3 FragPos;
+
+uniform mat4 u_camMatrix;
+uniform mat4 u_Model;
+uniform vec4 u_Color;
+uniform vec4 u_ControlPoints[4];
+
+vec4 Bernstein(float t)
+{
+	float s = 1.0 - t;
+	return vec4(s * s * s, 3.0 * t * s * s, 3.0 * t * t * s, t * t * t);
+}
+
+// degree lowered by one and multiplied by degree
+vec3 BernsteinDerivative(float t)
+{
+	float s = 1.0 - t;
+	return vec3(3.0 * s * s, 6.0 * t * s, 3.0 * t * t);
+}
+
+void main()
+{
+	// the patch spans the control points, so the domain coordinate is the (u, v) of the surface
+	vec2 surfaceCoord = mix(te_SurfaceCoord[0], te_SurfaceCoord[15], gl_TessCoord.xy);
+
+	vec4 bx = Bernstein(surfaceCoord.x);
+	vec3 dbx = BernsteinDerivative(surfaceCoord.x);
+	vec4 by = Bernstein(surfaceCoord.y);
+	vec3 dby = BernsteinDerivative(surfaceCoord.y);
+
+	vec4 curve = vec4(0.0);
+	vec4 curveDx = vec4(0.0);
+	for (int i = 0; i < 4; i++)
+		curve += bx[i] * u_ControlPoints[i];
+	for (int i = 0; i < 3; i++)
+		curveDx += dbx[i] * (u_ControlPoints[i + 1] - u_ControlPoints[i]);
+
+	float height = dot(curve, by);
+	float dx = dot(curveDx, by);
+	float dz = dot(curve.yzw - curve.xyz, dby);
+
+	vec4 position = vec4(surfaceCoord.x, height, surfaceCoord.y, 1.0);
+	v_TexCoord = surfaceCoord;
 	gl_Position = u_camMatrix * u_Model * position;
 	FragPos = vec3(u_Model * position);
 	v_Color = u_Color;
-	v_Normal = mat3(transpose(inverse(u_Model))) * normal;
+	v_Normal = mat3(transpose(inverse(u_Model))) * normalize(vec3(-dx, 1.0, -dz));
 };
 
 #shader fragment
@@ -68,7 +299,7 @@ vec3 PointLight(Light light, vec3 worldPos, vec3 worldNormal)
 	float specAmount = pow(max(dot(viewDirection, reflectionDirection), 0.0f), 16);
 	float specular = specAmount * specularLight;
 
-	return (diffuse * inten + specular * inten) * light.m_LightColor * v_Color * texture(u_Texture, v_TexCoord);
+	return vec3((diffuse * inten + specular * inten) * light.m_LightColor * v_Color * texture(u_Texture, v_TexCoord));
 }
 
 vec3 SpotLight(Light light, vec3 worldPos, vec3 worldNormal)
@@ -119,7 +350,7 @@ float CalcFogFactor(vec3 worldPos)
 {
 	float fogIntensity = 0.8f;
 	if (fogIntensity == 0) 
-		return 1;
+		return 1.0;
 	
 	float gradient = (fogIntensity * fogIntensity - 50 * fogIntensity + 60);
 	float distance = length(u_ViewPos - worldPos);
@@ -140,7 +371,7 @@ float CalcFogFactor(vec3 worldPos)
 
 void main()
 {
-	vec3 finalColor;
+	vec3 finalColor = vec3(0.0);
 	float ambient = 0.1f;
 	finalColor += vec3(v_Color * texture(u_Texture, v_TexCoord) * ambient);
 	for (int i = 0; i < LIGHT_COUNT; i++)
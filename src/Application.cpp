@@ -14,27 +14,126 @@
 #include "Classes/Public/Camera.h"
 #include "Classes/Public/Mesh.h"
 #include "Classes/Public/ChessBoard.h"
+#include "Classes/Public/RenderQueue.h"
+#include "Classes/Public/OcclusionQueries.h"
 #include "enums/ObjectType.h"
 #include "Classes/Public/Bezier.h"
+#include "Classes/Public/BezierTerrain.h"
+#include "Classes/Public/Benchmark.h"
+#include "Classes/Public/AssetLoader.h"
 
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 800;
 
-static std::shared_ptr<ChessBoard> Setup()
+static bool HasArgument(int argc, char** argv, const std::string& name)
 {
-	std::map<int, std::shared_ptr<Mesh>> meshes = {
-		{ OT_Pawn, std::shared_ptr<Mesh>(new Mesh("res/textures/pawn/pawn.obj")) },
-		{ OT_Rook, std::shared_ptr<Mesh>(new Mesh("res/textures/rook/rook.obj")) },
-		{ OT_Knight, std::shared_ptr<Mesh>(new Mesh("res/textures/knight/knight.obj")) },
-		{ OT_Bishop, std::shared_ptr<Mesh>(new Mesh("res/textures/bishop/bishop.obj")) },
-		{ OT_Queen, std::shared_ptr<Mesh>(new Mesh("res/textures/queen/queen.obj")) },
-		{ OT_King, std::shared_ptr<Mesh>(new Mesh("res/textures/king/king.obj")) },
-		{ OT_Board, std::shared_ptr<Mesh>(new Mesh("res/textures/board/board.obj")) }
-	};
-	std::shared_ptr<Texture> chessPieceTexture ( new Texture("res/textures/pieceTex.JPG"));
-	std::shared_ptr<Texture> chessboardTexture (new Texture("res/textures/board/chessboard.jpg"));
+	for (int i = 1; i < argc; i++)
+		if (name == argv[i])
+			return true;
+	return false;
+}
+
+// value following name, e.g. "--board vertex"
+static std::string GetArgumentValue(int argc, char** argv, const std::string& name, const std::string& defaultValue)
+{
+	for (int i = 1; i < argc - 1; i++)
+		if (name == argv[i])
+			return argv[i + 1];
+	return defaultValue;
+}
 
-	std::shared_ptr<Mesh> bezierMesh((Mesh*)new Bezier());
+// "auto" - tessellation shaders when the context has them, CPU tessellation otherwise
+static BezierMode ParseBoardMode(const std::string& value, bool tessellationSupported)
+{
+	if (value == "vertex")
+		return BM_VertexShader;
+	if (value == "feedback")
+		return BM_TransformFeedback;
+	if (value == "tessellation" || value == "auto")
+	{
+		if (tessellationSupported)
+			return BM_Tessellation;
+		if (value == "tessellation")
+			std::cout << "Tessellation shaders need OpenGL 4.0, board is tessellated on the CPU\n";
+	}
+	return BM_CPU;
+}
+
+// Collects per-frame counters and prints their averages once per second (--stats)
+struct FrameStats
+{
+	int Frames = 0;
+	float Time = 0.f;
+	unsigned long long UploadedBytes = 0;
+	unsigned long long BoardVertices = 0;
+	unsigned long long DrawnIndices = 0;
+	unsigned long long DrawPackets = 0;
+	unsigned long long StateChanges = 0;
+	unsigned long long DrawnObjects = 0;
+	unsigned long long CulledObjects = 0;
+	unsigned long long OccludedPieces = 0;
+	unsigned long long StateCalls = 0;
+	unsigned long long SkippedStateCalls = 0;
+
+	void BeginFrame()
+	{
+		VertexBuffer::ResetUploadedBytes();
+		Mesh::ResetDrawnIndices();
+		Renderer::ResetStateCounters();
+	}
+
+	// queue - flushed this frame, the counts of its last Flush are taken
+	void EndFrame(float frameTime, uint boardVertices, const RenderQueue& queue, uint occludedPieces)
+	{
+		Frames++;
+		Time += frameTime;
+		UploadedBytes += VertexBuffer::GetUploadedBytes();
+		BoardVertices += boardVertices;
+		DrawnIndices += Mesh::GetDrawnIndices();
+		DrawPackets += queue.GetFlushedPackets();
+		StateChanges += queue.GetShaderChanges() + queue.GetMeshChanges() + queue.GetTextureChanges();
+		DrawnObjects += queue.GetDrawnObjects();
+		CulledObjects += queue.GetCulledObjects();
+		OccludedPieces += occludedPieces;
+		StateCalls += Renderer::GetStateCalls();
+		SkippedStateCalls += Renderer::GetSkippedStateCalls();
+
+		if (Time < 1000.f)
+			return;
+
+		std::cout << "cpu frame " << Time / Frames << " ms, vertex upload " << UploadedBytes / Frames / 1024.f << " KB/frame, "
+			<< "board vertices " << BoardVertices / Frames << ", indices drawn " << DrawnIndices / Frames
+			<< ", draw packets " << DrawPackets / Frames << " (" << StateChanges / Frames << " state changes), "
+			<< "objects " << DrawnObjects / Frames << " drawn, " << CulledObjects / Frames << " culled, "
+			<< OccludedPieces / Frames << " pieces occluded, "
+			<< "GL state calls " << StateCalls / Frames << " issued, " << SkippedStateCalls / Frames << " skipped\n";
+		*this = FrameStats();
+	}
+};
+
+// Requests the board and piece assets from assets and finishes its batch, with anything the caller requested before
+static std::shared_ptr<ChessBoard> Setup(BezierMode boardMode, AssetLoader& assets)
+{
+	std::map<int, std::string> meshPaths = {
+		{ OT_Pawn, "res/textures/pawn/pawn.obj" },
+		{ OT_Rook, "res/textures/rook/rook.obj" },
+		{ OT_Knight, "res/textures/knight/knight.obj" },
+		{ OT_Bishop, "res/textures/bishop/bishop.obj" },
+		{ OT_Queen, "res/textures/queen/queen.obj" },
+		{ OT_King, "res/textures/king/king.obj" },
+		{ OT_Board, "res/textures/board/board.obj" }
+	};
+	std::map<int, std::shared_ptr<Mesh>> meshes;
+	for (auto& meshPath : meshPaths)
+		assets.LoadMesh(meshPath.second, &meshes[meshPath.first]);
+	std::shared_ptr<Texture> chessPieceTexture;
+	std::shared_ptr<Texture> chessboardTexture;
+	assets.LoadTexture("res/textures/pieceTex.JPG", &chessPieceTexture);
+	assets.LoadTexture("res/textures/board/chessboard.jpg", &chessboardTexture);
+	assets.Finish();
+
+	// finest level, used only by tiles close to the camera
+	std::shared_ptr<Mesh> bezierMesh((Mesh*)new Bezier(256, boardMode));
 	float bezierScale = 8.0f;
 
 	Model::meshMap = meshes;
@@ -131,7 +230,7 @@ static void OtherInput(bool& fog, GLFWwindow* window, glm::vec3& SpotLightDir)
 	}
 }
 
-int main()
+int main(int argc, char** argv)
 {
 	// Initialize GLFW
 	GLFWwindow* window;
@@ -139,12 +238,21 @@ int main()
 	if(!glfwInit())
 		return -1;
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	// 4.0 for the tessellation shaders of the board, everything else runs on 3.3
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// debug output is only promised by debug contexts
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_CHECK_ENABLED);
 
 	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Chess 3D", NULL, NULL);
 	if (!window)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Chess 3D", NULL, NULL);
+	}
+	if (!window)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
 		glfwTerminate();
@@ -160,19 +268,99 @@ int main()
 
 	std::cout << glGetString(GL_VERSION) << "\n";
 
-	glEnable(GL_DEPTH_TEST);
+#if GL_CHECK_ENABLED
+	// errors come from the debug callback, --gl-validate n adds glGetError checks around one call in n
+	if (!GLInitDebugOutput())
+		std::cout << "No GL debug output, every GL call is checked with glGetError\n";
+	if (HasArgument(argc, argv, "--gl-validate"))
+		GLSetValidationInterval(atoi(GetArgumentValue(argc, argv, "--gl-validate", "1").c_str()));
+#endif
+
+	if (HasArgument(argc, argv, "--benchmark"))
+	{
+		RunBezierBenchmark();
+		RunBezierThreadingBenchmark();
+		RunBezierTerrainBenchmark();
+		RunBezierAsyncTickBenchmark();
+		RunIndexOrderBenchmark();
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return 0;
+	}
+
+	Renderer::SetEnabled(GL_DEPTH_TEST, true);
+
+	Renderer::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA);
+	Renderer::SetEnabled(GL_BLEND, true);
+
+	GLint GLMajorVersion = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &GLMajorVersion);
+	BezierMode BoardMode = ParseBoardMode(GetArgumentValue(argc, argv, "--board", "auto"), GLMajorVersion >= 4);
 
-	GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA));
-	glEnable(GL_BLEND);
+	// imported models keep 16-bit positions and normals unless --float-vertices
+	Mesh::s_QuantizeImport = !HasArgument(argc, argv, "--float-vertices");
 
-	std::shared_ptr<ChessBoard> Board = Setup();
+	// files of the whole scene are loaded in one parallel batch, finished by Setup
+	AssetLoader Assets;
+	std::shared_ptr<Mesh> LightMesh;
+	Assets.LoadMesh("res/textures/light/lightbulb.obj", &LightMesh);
+	// same file as the pieces use, loaded once and shared
+	std::shared_ptr<Texture> MovingKnightTexture;
+	Assets.LoadTexture("res/textures/pieceTex.JPG", &MovingKnightTexture);
+	bool ShowTable = HasArgument(argc, argv, "--table");
+	std::shared_ptr<Texture> TableTexture;
+	if (ShowTable)
+		Assets.LoadTexture("res/textures/wood.jpg", &TableTexture);
 
+	std::shared_ptr<ChessBoard> Board = Setup(BoardMode, Assets);
+	// next board tick is tessellated while the current one is drawn, --sync-tick keeps it on the render thread
+	if (!HasArgument(argc, argv, "--sync-tick"))
+		((Bezier*)Board->GetMesh().get())->EnableAsyncTick();
+
+	// every shader drawing lit scene objects, all get camera and lights uniforms
 	std::vector<std::shared_ptr<Shader>> Shaders;
-	std::shared_ptr<Shader> PhongShader(new Shader("res/shaders/Phong.shader"));
+	std::vector<std::string> MeshDefines;
+	if (Mesh::s_QuantizeImport)
+		MeshDefines.push_back("QUANTIZED_MESH");
+	std::shared_ptr<Shader> PhongShader(new Shader("res/shaders/Phong.shader", MeshDefines));
+	Shaders.push_back(PhongShader);
+
+	// pieces are drawn with one instanced call per type and level of detail
+	std::vector<std::string> PieceDefines = MeshDefines;
+	PieceDefines.push_back("INSTANCED");
+	std::shared_ptr<Shader> PieceShader(new Shader("res/shaders/Phong.shader", PieceDefines));
+	Board->SetPieceShader(PieceShader);
+	Shaders.push_back(PieceShader);
+
+	// board mesh has its own vertex format, drawn with a variant of Phong.shader
+	std::shared_ptr<Shader> SurfaceShader(new Shader("res/shaders/Phong.shader", { ((Bezier*)Board->GetMesh().get())->GetShaderDefine() }));
+	Board->SetSurfaceShader(SurfaceShader);
+	Shaders.push_back(SurfaceShader);
+
+	// rolling table under the board, one multi-patch surface
+	std::shared_ptr<Model> Table;
+	std::shared_ptr<Shader> TableShader;
+	if (ShowTable)
+	{
+		std::shared_ptr<Mesh> tableMesh((Mesh*)new BezierTerrain(4, 4, 16));
+		Table = std::shared_ptr<Model>(new Model(tableMesh, TableTexture, glm::vec3(-12.f, -3.5f, -12.f)));
+		Table->SetScale(6.f);
+		TableShader = std::shared_ptr<Shader>(new Shader("res/shaders/Phong.shader", { "BEZIER_STREAM" }));
+		Shaders.push_back(TableShader);
+	}
+
+	// pieces hidden behind others last frame are drawn only when their bounding box passes an occlusion query
+	if (!HasArgument(argc, argv, "--no-occlusion"))
+	{
+		std::shared_ptr<Shader> OcclusionShader(new Shader("res/shaders/Light.shader"));
+		Board->SetOcclusionQueries(std::shared_ptr<OcclusionQueries>(new OcclusionQueries(SIZE * SIZE, OcclusionShader)));
+	}
 
 	Shader::m_CurrShader = PhongShader;
 
 	Renderer renderer;
+	// every draw of the frame, sorted by shader, texture, mesh and depth
+	RenderQueue Queue;
 	
 #pragma region Cameras
 	std::vector<std::shared_ptr<Camera>> Cameras;
@@ -193,7 +381,6 @@ int main()
 #pragma endregion
 
 	std::shared_ptr<Shader> lightShader (new Shader("res/shaders/Light.shader"));
-	std::shared_ptr<Mesh> LightMesh (new Mesh("res/textures/light/lightbulb.obj"));
 	std::shared_ptr<Model> LightBulb (new Model(LightMesh, nullptr, glm::vec3(-2.f, 2.f, 0.f)));
 	std::shared_ptr<Model> LightBulb2 (new Model(LightMesh, nullptr, glm::vec3(2.f, 2.f, 0.f)));
 	LightBulb->SetScale(glm::vec3(0.5f, 0.5f, 0.5f));
@@ -208,8 +395,11 @@ int main()
 
 	bool Fog = false;
 
+	bool PrintStats = HasArgument(argc, argv, "--stats");
+	FrameStats Stats;
+
 #pragma region Moving knight
-	std::shared_ptr<Model> MovingKnight(new Model(Model::meshMap[OT_Knight], std::shared_ptr<Texture>(new Texture("res/textures/pieceTex.JPG"))));
+	std::shared_ptr<Model> MovingKnight(new Model(Model::meshMap[OT_Knight], MovingKnightTexture));
 	MovingKnight->SetScale(glm::vec3(0.15f, 0.15f, 0.15f));
 	glm::vec3 cb_A1Pos(-3.5f, -1.9f, 3.5f);
 	float minRow = 1.f;
@@ -233,6 +423,9 @@ int main()
 	// Main while loop
 	while (!glfwWindowShouldClose(window))
 	{
+		clock::time_point frameStart = clock::now();
+		Stats.BeginFrame();
+
 		renderer.Clear();
 
 		SwitchCamerasInput(Cameras, window);
@@ -241,17 +434,6 @@ int main()
 		Shader::m_CurrShader->Bind();
 
 		Camera::m_CurrCam->Inputs(window, *Shader::m_CurrShader);
-		Camera::m_CurrCam->UpdateUniform(*Shader::m_CurrShader);
-
-		Shader::m_CurrShader->SetUniform1i("u_FogEnabled", Fog);
-
-		Shader::m_CurrShader->SetUniform4f("lights[0].m_LightColor", 1.f, 1.f, 1.f, 1.f);
-		Shader::m_CurrShader->SetUniform3f("lights[0].m_LightPos", LightBulb->GetPosition());
-		Shader::m_CurrShader->SetUniform1i("lights[0].m_IsPointLight", true);
-
-		Shader::m_CurrShader->SetUniform4f("lights[1].m_LightColor", 1.f, 1.f, 1.f, 1.f);
-		Shader::m_CurrShader->SetUniform3f("lights[1].m_LightPos", LightBulb2->GetPosition());
-		Shader::m_CurrShader->SetUniform1i("lights[1].m_IsPointLight", true);
 
 		// SpotLights
 		glm::vec3 GreenSpotLightPos(MovingKnight->GetPosition());
@@ -261,19 +443,38 @@ int main()
 		GreenSpotLightPos.y += 1.5f;
 		RedSpotLightPos.y += 1.5f;
 
-		Shader::m_CurrShader->SetUniform4f("lights[2].m_LightColor", 0.f, 1.f, 0.f, 1.f);
-		Shader::m_CurrShader->SetUniform3f("lights[2].m_LightPos", GreenSpotLightPos);
-		Shader::m_CurrShader->SetUniform1i("lights[2].m_IsPointLight", false);
-		Shader::m_CurrShader->SetUniform3f("lights[2].m_LightDir", GreenSpotLightDir);
+		for (std::shared_ptr<Shader>& shader : Shaders)
+		{
+			shader->Bind();
+			Camera::m_CurrCam->UpdateUniform(*shader);
+
+			shader->SetUniform1i("u_FogEnabled", Fog);
+
+			shader->SetUniform4f("lights[0].m_LightColor", 1.f, 1.f, 1.f, 1.f);
+			shader->SetUniform3f("lights[0].m_LightPos", LightBulb->GetPosition());
+			shader->SetUniform1i("lights[0].m_IsPointLight", true);
 
-		Shader::m_CurrShader->SetUniform4f("lights[3].m_LightColor", 1.f, 0.f, 0.f, 1.f);
-		Shader::m_CurrShader->SetUniform3f("lights[3].m_LightPos", RedSpotLightPos);
-		Shader::m_CurrShader->SetUniform1i("lights[3].m_IsPointLight", false);
-		Shader::m_CurrShader->SetUniform3f("lights[3].m_LightDir", RedSpotLightDir);
+			shader->SetUniform4f("lights[1].m_LightColor", 1.f, 1.f, 1.f, 1.f);
+			shader->SetUniform3f("lights[1].m_LightPos", LightBulb2->GetPosition());
+			shader->SetUniform1i("lights[1].m_IsPointLight", true);
 
-		Shader::m_CurrShader->SetUniform3f("u_ViewPos", Freecamera->GetPosition());
-		Board->Draw(renderer, *Shader::m_CurrShader);
-		//Shader::m_CurrShader->SetUniform4f("u_Color", 0.4f, 0.4f, 0.4f, 1.f);
+			shader->SetUniform4f("lights[2].m_LightColor", 0.f, 1.f, 0.f, 1.f);
+			shader->SetUniform3f("lights[2].m_LightPos", GreenSpotLightPos);
+			shader->SetUniform1i("lights[2].m_IsPointLight", false);
+			shader->SetUniform3f("lights[2].m_LightDir", GreenSpotLightDir);
+
+			shader->SetUniform4f("lights[3].m_LightColor", 1.f, 0.f, 0.f, 1.f);
+			shader->SetUniform3f("lights[3].m_LightPos", RedSpotLightPos);
+			shader->SetUniform1i("lights[3].m_IsPointLight", false);
+			shader->SetUniform3f("lights[3].m_LightDir", RedSpotLightDir);
+
+			shader->SetUniform3f("u_ViewPos", Freecamera->GetPosition());
+		}
+
+		Board->Submit(Queue, *Shader::m_CurrShader);
+
+		if (Table != nullptr)
+			Queue.Submit(*Table, *TableShader, glm::vec4(0.6f, 0.45f, 0.3f, 1.f));
 
 		// moving knight
 		duration elapsed = clock::now() - start;
@@ -304,7 +505,17 @@ int main()
 		}
 		float newY = 0;
 		MovingKnight->SetPosition(glm::vec3(cb_A1Pos.x + curPos.x, cb_A1Pos.y + newY, cb_A1Pos.z - curPos.z));
-		MovingKnight->Draw(*Shader::m_CurrShader);
+		Queue.Submit(*MovingKnight, *Shader::m_CurrShader, glm::vec4(0.4f, 0.4f, 0.4f, 1.f));
+
+		// lights
+		lightShader->Bind();
+		Camera::m_CurrCam->UpdateUniform(*lightShader);
+		Queue.Submit(*LightBulb, *lightShader, glm::vec4(1.f));
+		Queue.Submit(*LightBulb2, *lightShader, glm::vec4(1.f));
+
+		// the board is drawn before Tick streams the heights of the next one
+		Queue.Flush();
+		Board->DrawOcclusionPass();
 
 		FocusedCamera->LookAt(MovingKnight->GetPosition());
 		glm::vec3 FPCamPos = MovingKnight->GetPosition();
@@ -313,14 +524,11 @@ int main()
 
 		// bezier animation
 		Board->Tick(elapsed.count() / 100);
+		if (Table != nullptr)
+			((BezierTerrain*)Table->GetMesh().get())->Tick(elapsed.count() / 100);
 
-		// lights
-		lightShader->Bind();
-		Camera::m_CurrCam->UpdateUniform(*lightShader);
-		lightShader->SetUniform4f("u_Color", 1.f, 1.f, 1.f, 1.f);
-		LightBulb->Draw(*lightShader);
-		LightBulb2->Draw(*lightShader);
-		
+		if (PrintStats)
+			Stats.EndFrame(duration(clock::now() - frameStart).count(), ((Bezier*)Board->GetMesh().get())->GetActiveVertexCount(), Queue, Board->GetOccludedPieces());
 
 		// Swap the back buffer with the front buffer
 		glfwSwapBuffers(window);
@@ -0,0 +1,121 @@
+#include "../Public/AssetLoader.h"
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+
+typedef std::chrono::high_resolution_clock Clock;
+typedef std::chrono::duration<float, std::milli> Duration;
+
+void AssetLoader::LoadMesh(const std::string& path, std::shared_ptr<Mesh>* target)
+{
+	GetAsset(AT_Mesh, path).MeshTargets.push_back(target);
+}
+
+void AssetLoader::LoadTexture(const std::string& path, std::shared_ptr<Texture>* target)
+{
+	GetAsset(AT_Texture, path).TextureTargets.push_back(target);
+}
+
+AssetLoader::Asset& AssetLoader::GetAsset(AssetType type, const std::string& path)
+{
+	for (std::unique_ptr<Asset>& asset : m_Assets)
+		if (asset->Type == type && asset->Path == path)
+			return *asset;
+
+	m_Assets.push_back(std::unique_ptr<Asset>(new Asset()));
+	m_Assets.back()->Type = type;
+	m_Assets.back()->Path = path;
+	return *m_Assets.back();
+}
+
+void AssetLoader::Finish(bool printTimings)
+{
+	if (m_Assets.empty())
+		return;
+
+	Clock::time_point start = Clock::now();
+	m_NextAsset = 0;
+	m_Completed.clear();
+
+	// one asset per worker at a time, all of them at once when there are enough hardware threads
+	uint threadCount = std::min((uint)m_Assets.size(), std::max(std::thread::hardware_concurrency(), 1u));
+	std::vector<std::thread> workers;
+	for (uint i = 0; i < threadCount; i++)
+		workers.push_back(std::thread(&AssetLoader::WorkerLoop, this));
+
+	// GL objects of an asset are created as soon as it's loaded, while the others are still loading
+	for (size_t created = 0; created < m_Assets.size(); created++)
+	{
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(m_QueueMutex);
+			m_AssetLoaded.wait(lock, [this] { return !m_Completed.empty(); });
+			index = m_Completed.front();
+			m_Completed.erase(m_Completed.begin());
+		}
+		CreateObjects(*m_Assets[index]);
+	}
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	if (printTimings)
+	{
+		float loadSum = 0.f;
+		float slowest = 0.f;
+		for (std::unique_ptr<Asset>& asset : m_Assets)
+		{
+			std::cout << "Loaded " << asset->Path << " in " << asset->LoadTime << " ms, GL objects " << asset->CreateTime << " ms"
+				<< (asset->Loaded ? "" : " (failed)") << "\n";
+			loadSum += asset->LoadTime + asset->CreateTime;
+			slowest = std::max(slowest, asset->LoadTime + asset->CreateTime);
+		}
+		std::cout << m_Assets.size() << " assets on " << threadCount << " threads in " << Duration(Clock::now() - start).count()
+			<< " ms, one after another " << loadSum << " ms, slowest " << slowest << " ms\n";
+	}
+
+	// imported vertices, mapped caches and pixels go with the assets
+	m_Assets.clear();
+}
+
+void AssetLoader::WorkerLoop()
+{
+	for (int index = m_NextAsset++; index < (int)m_Assets.size(); index = m_NextAsset++)
+	{
+		Asset& asset = *m_Assets[index];
+		Clock::time_point start = Clock::now();
+		if (asset.Type == AT_Mesh)
+			asset.Loaded = Mesh::LoadData(asset.Path, asset.MeshResult);
+		else
+			asset.Loaded = Texture::Decode(asset.Path, asset.TextureResult);
+		asset.LoadTime = Duration(Clock::now() - start).count();
+
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_Completed.push_back(index);
+		}
+		m_AssetLoaded.notify_one();
+	}
+}
+
+void AssetLoader::CreateObjects(Asset& asset)
+{
+	if (!asset.Loaded)
+		return;
+
+	Clock::time_point start = Clock::now();
+	if (asset.Type == AT_Mesh)
+	{
+		std::shared_ptr<Mesh> mesh(new Mesh(asset.MeshResult));
+		for (std::shared_ptr<Mesh>* target : asset.MeshTargets)
+			*target = mesh;
+	}
+	else
+	{
+		std::shared_ptr<Texture> texture(new Texture(asset.TextureResult));
+		for (std::shared_ptr<Texture>* target : asset.TextureTargets)
+			*target = texture;
+	}
+	asset.CreateTime = Duration(Clock::now() - start).count();
+}
@@ -0,0 +1,196 @@
+#include "../Public/Benchmark.h"
+#include "../Public/Bezier.h"
+#include "../Public/BezierTerrain.h"
+#include "../Public/ThreadPool.h"
+#include "../Public/MeshOptimizer.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+
+typedef std::chrono::high_resolution_clock Clock;
+typedef std::chrono::duration<float, std::milli> Duration;
+
+// runs func until at least minTime passed (and at least minIterations times), returns average time of one run in ms
+template<typename F>
+static float MeasureAverage(F func, float minTime = 500.f, int minIterations = 3)
+{
+	int iterations = 0;
+	Clock::time_point start = Clock::now();
+	Duration elapsed(0.f);
+	while (iterations < minIterations || elapsed.count() < minTime)
+	{
+		func();
+		iterations++;
+		elapsed = Clock::now() - start;
+	}
+	return elapsed.count() / iterations;
+}
+
+void RunBezierBenchmark()
+{
+	const int precisions[] = { 50, 200, 1000 };
+
+	std::cout << "Bezier per-frame tessellation (CPU only, upload is the same for both)\n";
+	std::cout << std::setw(10) << "precision" << std::setw(12) << "vertices"
+		<< std::setw(14) << "direct [ms]" << std::setw(14) << "tables [ms]" << std::setw(10) << "speedup" << "\n";
+
+	for (int precision : precisions)
+	{
+		Bezier bezier(precision);
+		// animate a bit so the surface is not flat
+		bezier.Tick(1.f);
+		// compare the math only, threads are measured below
+		bezier.SetThreadPool(nullptr);
+
+		float direct = MeasureAverage([&]() { bezier.TessellateDirect(); }, 500.f, 1);
+		float tables = MeasureAverage([&]() { bezier.Tessellate(); });
+
+		// grid rounded up to whole tiles
+		precision = bezier.m_TriangulationPrecision;
+		std::cout << std::setw(10) << precision << std::setw(12) << (precision + 1) * (precision + 1)
+			<< std::setw(14) << std::fixed << std::setprecision(3) << direct
+			<< std::setw(14) << tables
+			<< std::setw(9) << std::setprecision(1) << direct / tables << "x\n";
+	}
+}
+
+void RunBezierThreadingBenchmark()
+{
+	const int precisions[] = { 200, 500, 1000, 2000 };
+	std::vector<uint> threadCounts = { 1, 2, 4, 8 };
+	uint hardwareThreads = std::thread::hardware_concurrency();
+	if (hardwareThreads > threadCounts.back())
+		threadCounts.push_back(hardwareThreads);
+
+	std::cout << "\nBezier tessellation on worker threads [ms per frame] (speedup against 1 thread)\n";
+	std::cout << std::setw(10) << "precision";
+	for (uint threads : threadCounts)
+		std::cout << std::setw(10) << threads << " thr    ";
+	std::cout << "\n";
+
+	for (int precision : precisions)
+	{
+		Bezier bezier(precision);
+		bezier.Tick(1.f);
+
+		std::cout << std::setw(10) << bezier.m_TriangulationPrecision;
+		float singleThreaded = 0.f;
+		for (uint threads : threadCounts)
+		{
+			ThreadPool pool(threads);
+			bezier.SetThreadPool(&pool);
+			float time = MeasureAverage([&]() { bezier.Tessellate(); });
+			bezier.SetThreadPool(nullptr);
+
+			if (threads == 1)
+				singleThreaded = time;
+			std::cout << std::setw(10) << std::fixed << std::setprecision(2) << time
+				<< " (" << std::setprecision(1) << singleThreaded / time << "x)";
+		}
+		std::cout << "\n";
+	}
+}
+
+void RunBezierTerrainBenchmark()
+{
+	// patches along a side, quads along a patch side
+	const int sizes[][2] = { { 4, 16 }, { 8, 32 }, { 8, 64 }, { 16, 64 } };
+
+	std::cout << "\nBezier terrain tessellation by forward differencing (single thread)\n";
+	std::cout << std::setw(10) << "patches" << std::setw(12) << "precision" << std::setw(12) << "vertices"
+		<< std::setw(12) << "[ms]" << std::setw(16) << "[ns/vertex]" << "\n";
+
+	for (const auto& size : sizes)
+	{
+		BezierTerrain terrain(size[0], size[0], size[1]);
+		terrain.SetThreadPool(nullptr);
+
+		float time = MeasureAverage([&]() { terrain.Tessellate(); });
+
+		std::cout << std::setw(6) << size[0] << "x" << std::setw(3) << size[0] << std::setw(12) << size[1]
+			<< std::setw(12) << terrain.GetVertexCount()
+			<< std::setw(12) << std::fixed << std::setprecision(3) << time
+			<< std::setw(16) << std::setprecision(2) << time * 1e6f / terrain.GetVertexCount() << "\n";
+	}
+}
+
+void RunBezierAsyncTickBenchmark()
+{
+	const int precisions[] = { 256, 1024, 2048 };
+	// CPU time of drawing one frame, stands in for the render thread's own work
+	const float renderTime = 2.f;
+
+	auto render = [renderTime]()
+	{
+		Clock::time_point start = Clock::now();
+		while (Duration(Clock::now() - start).count() < renderTime)
+			;
+	};
+
+	std::cout << "\nBezier tick on the render thread and in the background [ms per frame], render work " << renderTime << " ms\n";
+	std::cout << std::setw(10) << "precision" << std::setw(12) << "tick" << std::setw(12) << "sync" << std::setw(12) << "async"
+		<< std::setw(16) << "ticks/frame" << "\n";
+
+	for (int precision : precisions)
+	{
+		Bezier bezier(precision);
+		float tick = MeasureAverage([&]() { bezier.Tick(0.01f); });
+		float sync = MeasureAverage([&]() { render(); bezier.Tick(0.01f); });
+
+		// frames don't wait for a tick slower than them, they keep showing the last one
+		bezier.EnableAsyncTick();
+		uint ticks = bezier.GetTicks();
+		int frames = 0;
+		float async = MeasureAverage([&]() { render(); bezier.Tick(0.01f); frames++; });
+
+		std::cout << std::setw(10) << bezier.m_TriangulationPrecision
+			<< std::setw(12) << std::fixed << std::setprecision(2) << tick
+			<< std::setw(12) << sync << std::setw(12) << async
+			<< std::setw(16) << (float)(bezier.GetTicks() - ticks) / frames << "\n";
+	}
+}
+
+void RunIndexOrderBenchmark()
+{
+	std::cout << "\nIndex buffers, ACMR - vertex shader runs per triangle with a " << MESH_VERTEX_CACHE_SIZE << " vertex FIFO cache\n";
+	std::cout << std::setw(34) << "mesh" << std::setw(10) << "indices" << std::setw(8) << "bits" << std::setw(8) << "ACMR" << "\n";
+
+	auto print = [](const std::string& name, const std::vector<uint>& indices, uint mode, uint bits)
+	{
+		std::cout << std::setw(34) << name << std::setw(10) << indices.size() << std::setw(8) << bits
+			<< std::setw(8) << std::fixed << std::setprecision(3) << CalculateACMR(indices, mode) << "\n";
+	};
+	auto printBuffer = [&print](const std::string& name, const IndexBuffer& ib)
+	{
+		print(name, ib.ReadIndices(), ib.GetMode(), ib.GetType() == GL_UNSIGNED_SHORT ? 16 : 32);
+	};
+
+	// the board at full resolution, row by row as it used to be built, then as it is built now
+	{
+		Bezier bezier(256);
+		int samples = bezier.m_TriangulationPrecision + 1;
+		print("board 256, rows", BuildGridIndices(samples, samples, false, samples), GL_TRIANGLES, 32);
+		printBuffer("board 256, tiles in Morton order", ((Mesh&)bezier).GetIndexBuffer());
+	}
+
+	{
+		BezierTerrain list(4, 4, 16, false);
+		BezierTerrain strips(4, 4, 16, true);
+		int samples = 4 * 16 + 1;
+		print("table, rows", BuildGridIndices(samples, samples, false, samples), GL_TRIANGLES, 32);
+		printBuffer("table, bands", ((Mesh&)list).GetIndexBuffer());
+		printBuffer("table, strips in bands", ((Mesh&)strips).GetIndexBuffer());
+	}
+
+	const char* pieces[] = { "pawn", "rook", "knight", "bishop", "queen", "king" };
+	for (const char* piece : pieces)
+	{
+		std::string path = std::string("res/textures/") + piece + "/" + piece + ".obj";
+		if (!std::ifstream(path))
+			continue;
+		Mesh mesh(path);
+		printBuffer(piece, mesh.GetIndexBuffer());
+	}
+}
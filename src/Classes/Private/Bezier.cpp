@@ -2,65 +2,192 @@
 #include "../Public/VertexArray.h"
 #include "../Public/VertexBuffer.h"
 #include "../Public/VertexBufferLayout.h"
+#include <algorithm>
 
-Bezier::Bezier(int precision) :
-	m_TriangulationPrecision(precision)
+// smaller grids are tessellated on the calling thread, waking workers would cost more than it saves
+#define BEZIER_PARALLEL_MIN_ROWS 128
+// rows per band when split between threads, more bands than threads evens out uneven progress
+#define BEZIER_ROWS_PER_BAND 32
+
+// level of detail: wanted length of a grid quad side on screen in pixels
+#define BEZIER_LOD_PIXELS 8.f
+// allowed distance between the surface and its triangles in pixels
+#define BEZIER_LOD_ERROR_PIXELS 0.5f
+// a tile goes one level coarser only once it needs less than this part of the coarser level's quads,
+// so tiles near a level boundary don't switch back and forth every frame
+#define BEZIER_LOD_HYSTERESIS 0.75f
+// clip w below which a tile corner counts as at (or behind) the camera, the tile gets the finest level
+#define BEZIER_LOD_MIN_W 0.01f
+// BM_VertexShader and BM_TransformFeedback: floats per vertex in m_MorphVB
+#define BEZIER_MORPH_ENDS_SIZE 6
+// BM_Tessellation: segments along a patch edge per unit of its length seen from a unit distance, capped at 64 by the shader
+#define BEZIER_TESSELLATION_DENSITY 96.f
+
+// x of a Morton (Z order) code: every second bit starting with the lowest, y is CompactBits(code >> 1)
+static int CompactBits(int code)
 {
-	float dist = 1.0f / m_TriangulationPrecision;
-	float curX = 0;
-	float curY = 0;
-	m_PositionTextureNormal = std::vector<float>();
-	for (int i = 0; i < m_TriangulationPrecision + 1; i++)
+	int result = 0;
+	for (int bit = 0; (code >> (2 * bit)) != 0; bit++)
+		result |= ((code >> (2 * bit)) & 1) << bit;
+	return result;
+}
+
+Bezier::Bezier(int precision, BezierMode mode) :
+	m_Mode(mode), m_ThreadPool(&ThreadPool::GetShared()), m_TickPending(false)
+{
+	m_TileSize = 1;
+	while (m_TileSize * BEZIER_TILES < precision)
+		m_TileSize *= 2;
+	m_TriangulationPrecision = m_TileSize * BEZIER_TILES;
+	// everything at the finest level until UpdateLevelOfDetail
+	m_TileSteps.assign(BEZIER_TILES * BEZIER_TILES, 1);
+	std::fill(m_TileWanted, m_TileWanted + BEZIER_TILES * BEZIER_TILES, (float)m_TileSize);
+
+	int vertexCount = (m_TriangulationPrecision + 1) * (m_TriangulationPrecision + 1);
+
+	m_VA = new VertexArray();
+	m_VBL = new VertexBufferLayout();
+
+	if (m_Mode == BM_Tessellation)
+	{
+		BuildPatch();
+		return;
+	}
+
+	// flat (u, v) grid, which is also texture coordinate, changes only with tile levels, filled by BuildMesh
+	m_VB = new VertexBuffer(nullptr, vertexCount * 2 * sizeof(float));
+
+	// surface coords
+	m_VBL->Push<float>(2);
+	m_VA->AddBuffer(*m_VB, *m_VBL);
+
+	if (m_Mode == BM_VertexShader || m_Mode == BM_TransformFeedback)
+	{
+		// ends of the coarser edge and the tiles morphing the vertex, changes with tile levels like the grid
+		m_MorphVB = new VertexBuffer(nullptr, vertexCount * BEZIER_MORPH_ENDS_SIZE * sizeof(float));
+		m_MorphVBL = new VertexBufferLayout();
+		m_MorphVBL->Push<float>(4);
+		m_MorphVBL->Push<float>(2);
+	}
+
+	if (m_Mode == BM_VertexShader)
+	{
+		m_VA->AddBuffer(*m_MorphVB, *m_MorphVBL);
+	}
+	else if (m_Mode == BM_CPU)
+	{
+		// heights and slopes are the only thing changing, so they go to their own streamed buffer
+		m_HeightSlope.resize(vertexCount * BEZIER_VERTEX_SIZE);
+		BuildBasisTables();
+
+		m_DynamicVB = new VertexBuffer(nullptr, m_HeightSlope.size() * sizeof(float), GL_STREAM_DRAW);
+		m_DynamicVBL = new VertexBufferLayout();
+		// height, dHeight/dx, dHeight/dy
+		m_DynamicVBL->Push<float>(3);
+		m_VA->AddBuffer(*m_DynamicVB, *m_DynamicVBL);
+	}
+	else if (m_Mode == BM_TransformFeedback)
+	{
+		// the same stream as BM_CPU, filled by the feedback pass instead of uploads
+		m_DynamicVB = new VertexBuffer(nullptr, vertexCount * BEZIER_VERTEX_SIZE * sizeof(float), GL_DYNAMIC_COPY);
+		m_DynamicVBL = new VertexBufferLayout();
+		// height, dHeight/dx, dHeight/dy
+		m_DynamicVBL->Push<float>(3);
+		m_VA->AddBuffer(*m_DynamicVB, *m_DynamicVBL);
+
+		m_FeedbackShader = new Shader("res/shaders/BezierFeedback.shader", {}, { "tf_HeightSlope" });
+		m_FeedbackVA = new VertexArray();
+		m_FeedbackVA->AddBuffer(*m_VB, *m_VBL);
+		m_FeedbackVA->AddBuffer(*m_MorphVB, *m_MorphVBL);
+	}
+
+	m_IB = new IndexBuffer(nullptr, 0);
+	BuildMesh();
+	BuildCentreBasis();
+
+	if (m_Mode == BM_CPU)
+		UpdateArrays();
+	else if (m_Mode == BM_TransformFeedback)
+		RunFeedback();
+}
+
+Bezier::~Bezier()
+{
+	if (m_TickThread.joinable())
 	{
-		for (int j = 0; j < m_TriangulationPrecision + 1; j++)
 		{
-			// inits flat bezier
-			// coords
-			m_PositionTextureNormal.push_back(curX);
-			m_PositionTextureNormal.push_back(CalZ(curX, curY));
-			m_PositionTextureNormal.push_back(curY);
-			// texture
-			m_PositionTextureNormal.push_back((float)i / m_TriangulationPrecision);
-			m_PositionTextureNormal.push_back((float)j / m_TriangulationPrecision);
-			// normal
-			glm::vec3 normal = CalN(curX, curY);
-			m_PositionTextureNormal.push_back(normal.x);
-			m_PositionTextureNormal.push_back(normal.y);
-			m_PositionTextureNormal.push_back(normal.z);
-
-			curY += dist;
+			std::lock_guard<std::mutex> lock(m_TickMutex);
+			m_StopTick = true;
 		}
-		curY = 0;
-		curX += dist;
+		m_TickRequested.notify_one();
+		m_TickThread.join();
 	}
-	// index buffer
+	delete m_TickPool;
+
+	delete m_DynamicVB;
+	delete m_DynamicVBL;
+	delete m_MorphVB;
+	delete m_MorphVBL;
+	delete m_FeedbackShader;
+	delete m_FeedbackVA;
+}
+
+void Bezier::BuildPatch()
+{
+	// the control points at (i / 3, j / 3) as one patch, their heights are in u_ControlPoints
+	std::vector<float> controlGrid;
 	std::vector<uint> indices;
-	for (int i = 0; i < m_TriangulationPrecision; i++)
+	for (int i = 0; i < BEZIER_DEGREE; i++)
 	{
-		for (int j = 0; j < m_TriangulationPrecision; j++)
+		for (int j = 0; j < BEZIER_DEGREE; j++)
 		{
-			indices.push_back(i + j * (m_TriangulationPrecision + 1)); //tl
-			indices.push_back(i + j * (m_TriangulationPrecision + 1) + 1); //tr
-			indices.push_back(i + (j + 1) * (m_TriangulationPrecision + 1)); //bl
-			indices.push_back(i + j * (m_TriangulationPrecision + 1) + 1); //tr
-			indices.push_back(i + (j + 1) * (m_TriangulationPrecision + 1) + 1); //br
-			indices.push_back(i + (j + 1) * (m_TriangulationPrecision + 1));//bl
+			controlGrid.push_back((float)i / (BEZIER_DEGREE - 1));
+			controlGrid.push_back((float)j / (BEZIER_DEGREE - 1));
+			indices.push_back(i * BEZIER_DEGREE + j);
 		}
 	}
+	m_VB = new VertexBuffer(controlGrid.data(), controlGrid.size() * sizeof(float));
 
-	m_VA = new VertexArray();
-	m_VBL = new VertexBufferLayout();
-	m_IB = new IndexBuffer(indices.data(), indices.size());
-	m_VB = new VertexBuffer(m_PositionTextureNormal.data(), m_PositionTextureNormal.size() * sizeof(float));
-
-	// positions
-	m_VBL->Push<float>(3);
-	// texture
+	// surface coords
 	m_VBL->Push<float>(2);
-	// normals
-	m_VBL->Push<float>(3);
-
 	m_VA->AddBuffer(*m_VB, *m_VBL);
+	m_IB = new IndexBuffer(indices.data(), indices.size(), GL_PATCHES);
+
+	BuildCentreBasis();
+}
+
+void Bezier::BuildCentreBasis()
+{
+	int n = BEZIER_DEGREE - 1;
+	for (int k = 0; k < BEZIER_TILES; k++)
+	{
+		float t = (k + 0.5f) / BEZIER_TILES;
+		for (int i = 0; i <= n; i++)
+			m_CentreBasis[i * BEZIER_TILES + k] = B(i, n, t);
+		for (int i = 0; i <= n - 1; i++)
+			m_CentreBasisDerivative[i * BEZIER_TILES + k] = n * B(i, n - 1, t);
+	}
+	UpdateTileCentres();
+	UpdateBounds();
+}
+
+void Bezier::Draw() const
+{
+	if (m_Mode == BM_Tessellation)
+	{
+		GLCall(glPatchParameteri(GL_PATCH_VERTICES, BEZIER_DEGREE * BEZIER_DEGREE));
+	}
+	Mesh::Draw();
+}
+
+std::string Bezier::GetShaderDefine() const
+{
+	if (m_Mode == BM_VertexShader)
+		return "BEZIER_SURFACE";
+	if (m_Mode == BM_Tessellation)
+		return "BEZIER_PATCH";
+	// BM_CPU and BM_TransformFeedback draw the same streamed heights and slopes
+	return "BEZIER_STREAM";
 }
 
 float Bezier::CalZ(float x, float y)
@@ -75,18 +202,628 @@ float Bezier::CalZ(float x, float y)
 }
 
 void Bezier::Tick(float interval)
+{
+	if (m_AsyncTick)
+	{
+		// a finished tick becomes current, it was made while the last frames were drawn
+		if (FinishTick())
+			UploadHeightSlope();
+		StartTick(interval);
+		return;
+	}
+
+	MoveControlPoints(m_ControlPoints, interval);
+	UpdateTileCentres();
+	UpdateBounds();
+	m_Ticks++;
+	// in BM_VertexShader and BM_Tessellation modes the only per tick data are the control points, sent in SetUniforms
+	if (m_Mode == BM_CPU)
+		UpdateArrays();
+	else if (m_Mode == BM_TransformFeedback)
+		RunFeedback();
+}
+
+void Bezier::MoveControlPoints(float controlPoints[BEZIER_DEGREE][BEZIER_DEGREE], float interval)
 {
 	for (int i = 1; i < 3; i++)
 		for (int j = 1; j < 3; j++)
 		{
-			m_ControlPoints[i][j] += interval * m_ChangeSpeed[i - 1][j - 1];
-			if (std::abs(m_ControlPoints[i][j]) > m_MaxHeight)
+			controlPoints[i][j] += interval * m_ChangeSpeed[i - 1][j - 1];
+			if (std::abs(controlPoints[i][j]) > m_MaxHeight)
 				m_ChangeSpeed[i - 1][j - 1] = -m_ChangeSpeed[i - 1][j - 1];
 		}
-	UpdateArrays();
+}
+
+void Bezier::EnableAsyncTick()
+{
+	// the other modes have no CPU side tessellation to move off the render thread
+	if (m_Mode != BM_CPU || m_AsyncTick)
+		return;
+
+	m_AsyncTick = true;
+	// as many threads as the render thread has, nullptr stays single threaded
+	if (m_ThreadPool != nullptr)
+		m_TickPool = new ThreadPool(m_ThreadPool->GetThreadCount());
+	m_TickThread = std::thread(&Bezier::TickLoop, this);
+}
+
+void Bezier::StartTick(float interval)
+{
+	// the running tick keeps the back buffers, this frame's time moves the surface in the next one
+	if (m_TickStarted)
+	{
+		m_SkippedInterval += interval;
+		return;
+	}
+	interval += m_SkippedInterval;
+	m_SkippedInterval = 0.f;
+
+	// new tile levels are tessellated in the background as well, the drawn mesh switches when this tick is collected
+	const TileLayout* layout = m_LayoutChanged ? &m_NextLayout : &m_Layout;
+	m_LayoutChanged = false;
+
+	// back buffers belong to m_TickThread until the tick is collected, m_ChangeSpeed too
+	std::copy(&m_ControlPoints[0][0], &m_ControlPoints[0][0] + BEZIER_DEGREE * BEZIER_DEGREE, &m_BackControlPoints[0][0]);
+	std::copy(m_TileWanted, m_TileWanted + BEZIER_TILES * BEZIER_TILES, m_BackTileWanted);
+	m_BackHeightSlope.resize(m_HeightSlope.size());
+	ResizeActiveHeightSlope(*layout, m_BackActiveHeightSlope);
+
+	{
+		std::lock_guard<std::mutex> lock(m_TickMutex);
+		m_TickInterval = interval;
+		m_TickLayout = layout;
+		m_TickPending = true;
+	}
+	m_TickStarted = true;
+	m_TickRequested.notify_one();
+}
+
+bool Bezier::FinishTick()
+{
+	if (!m_TickStarted || m_TickPending.load(std::memory_order_acquire))
+		return false;
+	m_TickStarted = false;
+
+	// buffers change owners, nothing is copied but the 16 control points
+	m_HeightSlope.swap(m_BackHeightSlope);
+	m_ActiveHeightSlope.swap(m_BackActiveHeightSlope);
+	std::copy(&m_BackControlPoints[0][0], &m_BackControlPoints[0][0] + BEZIER_DEGREE * BEZIER_DEGREE, &m_ControlPoints[0][0]);
+	UpdateTileCentres();
+	UpdateBounds();
+	m_Ticks++;
+
+	// heights are for the new tile levels, so are the buffers from now on
+	if (m_TickLayout == &m_NextLayout)
+	{
+		std::swap(m_Layout, m_NextLayout);
+		UploadLayout();
+	}
+	return true;
+}
+
+void Bezier::TickLoop()
+{
+	while (true)
+	{
+		float interval;
+		const TileLayout* layout;
+		{
+			std::unique_lock<std::mutex> lock(m_TickMutex);
+			m_TickRequested.wait(lock, [this]() { return m_StopTick || m_TickPending; });
+			if (m_StopTick)
+				return;
+			interval = m_TickInterval;
+			layout = m_TickLayout;
+		}
+
+		MoveControlPoints(m_BackControlPoints, interval);
+		TessellateInto(m_BackControlPoints, *layout, m_BackTileWanted, m_TickPool, m_BackHeightSlope, m_BackActiveHeightSlope);
+
+		// the render thread collects the back buffers the next Tick, no lock or wakeup needed
+		m_TickPending.store(false, std::memory_order_release);
+	}
+}
+
+void Bezier::RunFeedback()
+{
+	m_FeedbackShader->Bind();
+	m_FeedbackShader->SetUniform4fv("u_ControlPoints", BEZIER_DEGREE, &m_ControlPoints[0][0]);
+	float factors[BEZIER_TILES * BEZIER_TILES];
+	GetMorphFactors(m_Layout.TileSteps, m_TileWanted, factors);
+	m_FeedbackShader->SetUniform1fv("u_TileMorph", BEZIER_TILES * BEZIER_TILES, factors);
+	m_FeedbackVA->Bind();
+	m_DynamicVB->BindFeedback(0);
+
+	// one point per active vertex, nothing is drawn
+	Renderer::SetEnabled(GL_RASTERIZER_DISCARD, true);
+	GLCall(glBeginTransformFeedback(GL_POINTS));
+	GLCall(glDrawArrays(GL_POINTS, 0, m_Layout.ActiveVertices.size()));
+	GLCall(glEndTransformFeedback());
+	Renderer::SetEnabled(GL_RASTERIZER_DISCARD, false);
+
+	GLCall(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0));
+}
+
+void Bezier::UpdateTileCentres()
+{
+	int n = BEZIER_DEGREE - 1;
+	for (int x = 0; x < BEZIER_TILES; x++)
+	{
+		// same row evaluation as Tessellate, on the tile centre basis
+		float curve[BEZIER_DEGREE];
+		float curveDx[BEZIER_DEGREE];
+		for (int j = 0; j <= n; j++)
+		{
+			curve[j] = 0.f;
+			for (int k = 0; k <= n; k++)
+				curve[j] += m_ControlPoints[k][j] * m_CentreBasis[k * BEZIER_TILES + x];
+
+			curveDx[j] = 0.f;
+			for (int k = 0; k <= n - 1; k++)
+				curveDx[j] += (m_ControlPoints[k + 1][j] - m_ControlPoints[k][j]) * m_CentreBasisDerivative[k * BEZIER_TILES + x];
+		}
+
+		EvaluateBezierRow(curve, curveDx, m_CentreBasis, m_CentreBasisDerivative, BEZIER_TILES,
+			&m_TileCentres[x * BEZIER_TILES * BEZIER_VERTEX_SIZE]);
+	}
+}
+
+void Bezier::UpdateBounds()
+{
+	auto heights = std::minmax_element(&m_ControlPoints[0][0], &m_ControlPoints[0][0] + BEZIER_DEGREE * BEZIER_DEGREE);
+	SetBounds(glm::vec3(0.f, *heights.first, 0.f), glm::vec3(1.f, *heights.second, 1.f));
+}
+
+glm::vec3 Bezier::GetTileNormal(int x, int y) const
+{
+	const float* centre = &m_TileCentres[(x * BEZIER_TILES + y) * BEZIER_VERTEX_SIZE];
+	return glm::normalize(glm::vec3(-centre[1], 1.f, -centre[2]));
+}
+
+void Bezier::SetUniforms(Shader& shader) const
+{
+	if (m_Mode == BM_VertexShader || m_Mode == BM_Tessellation)
+		shader.SetUniform4fv("u_ControlPoints", BEZIER_DEGREE, &m_ControlPoints[0][0]);
+	if (m_Mode == BM_Tessellation)
+		shader.SetUniform1f("u_TessellationDensity", BEZIER_TESSELLATION_DENSITY);
+	if (m_Mode == BM_VertexShader)
+	{
+		float factors[BEZIER_TILES * BEZIER_TILES];
+		GetMorphFactors(m_Layout.TileSteps, m_TileWanted, factors);
+		shader.SetUniform1fv("u_TileMorph", BEZIER_TILES * BEZIER_TILES, factors);
+	}
 }
 
 void Bezier::UpdateArrays()
+{
+	Tessellate();
+	UploadHeightSlope();
+}
+
+void Bezier::UploadHeightSlope()
+{
+	// same buffer and layout every frame, only the contents change
+	const std::vector<float>& data = m_ActiveHeightSlope.empty() ? m_HeightSlope : m_ActiveHeightSlope;
+	m_DynamicVB->Update(data.data(), m_Layout.ActiveVertices.size() * BEZIER_VERTEX_SIZE * sizeof(float));
+}
+
+bool Bezier::UpdateLevelOfDetail(const glm::mat4& mvp, float viewportHeight)
+{
+	// levels are picked per patch edge in the tessellation control shader
+	if (m_Mode == BM_Tessellation)
+		return false;
+	// the running tick reads m_NextLayout, the levels it was made for are drawn first
+	if (m_TickStarted && m_TickLayout == &m_NextLayout)
+		return false;
+
+	int corners = BEZIER_TILES + 1;
+	float span = 1.f / BEZIER_TILES;
+
+	// tile corners on screen and curvature there, each shared by up to four tiles
+	std::vector<glm::vec4> screen(corners * corners);
+	std::vector<float> curvature(corners * corners);
+	for (int i = 0; i < corners; i++)
+	{
+		for (int j = 0; j < corners; j++)
+		{
+			float x = i * span;
+			float y = j * span;
+			screen[i * corners + j] = mvp * glm::vec4(x, CalZ(x, y), y, 1.f);
+			curvature[i * corners + j] = CalCurvature(x, y);
+		}
+	}
+
+	bool changed = false;
+	for (int ty = 0; ty < BEZIER_TILES; ty++)
+	{
+		for (int tx = 0; tx < BEZIER_TILES; tx++)
+		{
+			int c[4] = {
+				tx * corners + ty, (tx + 1) * corners + ty,
+				tx * corners + ty + 1, (tx + 1) * corners + ty + 1
+			};
+
+			float wanted = (float)m_TileSize;
+			bool nearCamera = false;
+			for (int k = 0; k < 4; k++)
+				nearCamera = nearCamera || screen[c[k]].w < BEZIER_LOD_MIN_W;
+
+			if (!nearCamera)
+			{
+				glm::vec2 p[4];
+				for (int k = 0; k < 4; k++)
+					p[k] = glm::vec2(screen[c[k]]) / screen[c[k]].w * 0.5f * viewportHeight;
+				// side length in pixels, taken from the longer diagonal
+				float pixels = std::max(glm::length(p[3] - p[0]), glm::length(p[2] - p[1])) / sqrtf(2.f);
+				float tileCurvature = std::max(std::max(curvature[c[0]], curvature[c[1]]), std::max(curvature[c[2]], curvature[c[3]]));
+
+				// quads along the side so they are BEZIER_LOD_PIXELS long
+				float screenQuads = pixels / BEZIER_LOD_PIXELS;
+				// chord error of a quad of side h is h^2 / 8 * curvature, kept under BEZIER_LOD_ERROR_PIXELS
+				float pixelsPerUnit = pixels / span;
+				float curvatureQuads = span * sqrtf(tileCurvature * pixelsPerUnit / (8.f * BEZIER_LOD_ERROR_PIXELS));
+				wanted = std::max(screenQuads, curvatureQuads);
+			}
+
+			int quads = 1;
+			while (quads < wanted && quads < m_TileSize)
+				quads *= 2;
+
+			m_TileWanted[ty * BEZIER_TILES + tx] = wanted;
+			int& step = m_TileSteps[ty * BEZIER_TILES + tx];
+			int currentQuads = m_TileSize / step;
+			if (quads < currentQuads && wanted > currentQuads / 2 * BEZIER_LOD_HYSTERESIS)
+				continue;
+			if (quads != currentQuads)
+			{
+				step = m_TileSize / quads;
+				changed = true;
+			}
+		}
+	}
+
+	if (changed && m_AsyncTick)
+	{
+		// the running tick may read m_Layout, the old mesh is drawn until a tick made for the new one is collected
+		BuildLayout(m_NextLayout);
+		m_LayoutChanged = true;
+	}
+	else if (changed)
+	{
+		BuildMesh();
+	}
+	return changed;
+}
+
+void Bezier::BuildMesh()
+{
+	BuildLayout(m_Layout);
+	if (m_Mode == BM_CPU)
+		ResizeActiveHeightSlope(m_Layout, m_ActiveHeightSlope);
+	UploadLayout();
+}
+
+void Bezier::UploadLayout()
+{
+	Bind();
+	m_VB->Update(m_Layout.Grid.data(), m_Layout.Grid.size() * sizeof(float));
+	if (m_MorphVB != nullptr)
+		m_MorphVB->Update(m_Layout.MorphEnds.data(), m_Layout.MorphEnds.size() * sizeof(float));
+	m_IB->Update(m_Layout.Indices.data(), m_Layout.Indices.size());
+}
+
+void Bezier::BuildLayout(TileLayout& layout) const
+{
+	int samples = m_TriangulationPrecision + 1;
+	int vertexCount = samples * samples;
+
+	// triangles as grid indices first, compacted to the active vertices afterwards
+	std::vector<uint>& indices = layout.Indices;
+	indices.clear();
+	std::vector<int> remap(vertexCount, -1);
+	// tiles and quads inside them in Morton order, neighbouring quads come close together,
+	// so the vertices they share are still in the post-transform cache (rows of a tile don't fit in it)
+	for (int tile = 0; tile < BEZIER_TILES * BEZIER_TILES; tile++)
+	{
+		int tx = CompactBits(tile);
+		int ty = CompactBits(tile >> 1);
+		int step = m_TileSteps[ty * BEZIER_TILES + tx];
+		// shared edges use the coarser step of the two tiles, so both sides have the same vertices
+		int left = tx > 0 ? std::max(step, m_TileSteps[ty * BEZIER_TILES + tx - 1]) : step;
+		int right = tx < BEZIER_TILES - 1 ? std::max(step, m_TileSteps[ty * BEZIER_TILES + tx + 1]) : step;
+		int bottom = ty > 0 ? std::max(step, m_TileSteps[(ty - 1) * BEZIER_TILES + tx]) : step;
+		int top = ty < BEZIER_TILES - 1 ? std::max(step, m_TileSteps[(ty + 1) * BEZIER_TILES + tx]) : step;
+
+		auto vertex = [&](int a, int b) -> uint
+		{
+			if (a == 0)
+				b = SnapToStep(b, left);
+			else if (a == m_TileSize)
+				b = SnapToStep(b, right);
+			if (b == 0)
+				a = SnapToStep(a, bottom);
+			else if (b == m_TileSize)
+				a = SnapToStep(a, top);
+			int index = (tx * m_TileSize + a) * samples + ty * m_TileSize + b;
+			remap[index] = 0;
+			return index;
+		};
+
+		int quads = m_TileSize / step;
+		for (int quad = 0; quad < quads * quads; quad++)
+		{
+			int a = CompactBits(quad) * step;
+			int b = CompactBits(quad >> 1) * step;
+			uint tl = vertex(a, b);
+			uint tr = vertex(a, b + step);
+			uint bl = vertex(a + step, b);
+			uint br = vertex(a + step, b + step);
+			// snapping collapses some triangles on edges to coarser tiles
+			if (tl != tr && tr != bl && bl != tl)
+			{
+				indices.push_back(tl);
+				indices.push_back(tr);
+				indices.push_back(bl);
+			}
+			if (tr != br && br != bl && bl != tr)
+			{
+				indices.push_back(tr);
+				indices.push_back(br);
+				indices.push_back(bl);
+			}
+		}
+	}
+
+	// active vertices in grid order, rows stay contiguous for Tessellate
+	layout.ActiveVertices.clear();
+	layout.RowStart.assign(samples + 1, 0);
+	layout.Grid.clear();
+	for (int i = 0; i < samples; i++)
+	{
+		layout.RowStart[i] = layout.ActiveVertices.size();
+		for (int j = 0; j < samples; j++)
+		{
+			if (remap[i * samples + j] < 0)
+				continue;
+			remap[i * samples + j] = layout.ActiveVertices.size();
+			layout.ActiveVertices.push_back(i * samples + j);
+			layout.Grid.push_back((float)i / m_TriangulationPrecision);
+			layout.Grid.push_back((float)j / m_TriangulationPrecision);
+		}
+	}
+	layout.RowStart[samples] = layout.ActiveVertices.size();
+
+	for (uint& index : indices)
+		index = remap[index];
+
+	// vertices of each tile its next coarser level doesn't have, with the coarser edge they lie on
+	layout.TileSteps = m_TileSteps;
+	layout.Morphs.clear();
+	layout.MorphEnds.clear();
+	if (m_Mode == BM_Tessellation)
+		return;
+	for (int tile = 0; tile < BEZIER_TILES * BEZIER_TILES; tile++)
+	{
+		int tx = tile % BEZIER_TILES;
+		int ty = tile / BEZIER_TILES;
+		int step = m_TileSteps[tile];
+		if (step == m_TileSize)
+			continue;
+
+		auto index = [&](int a, int b) { return (tx * m_TileSize + a) * samples + ty * m_TileSize + b; };
+		for (int a = 0; a <= m_TileSize; a += step)
+		{
+			for (int b = 0; b <= m_TileSize; b += step)
+			{
+				bool oddA = a % (2 * step) != 0;
+				bool oddB = b % (2 * step) != 0;
+				if (!oddA && !oddB)
+					continue;
+
+				MorphVertex morph;
+				morph.Tiles[0] = tile;
+				morph.Tiles[1] = -1;
+				// an edge at the neighbour's coarser step has no such vertex, one at the same step is listed by the first tile
+				int neighbour = -1;
+				if (a == 0 && tx > 0)
+					neighbour = tile - 1;
+				else if (a == m_TileSize && tx < BEZIER_TILES - 1)
+					neighbour = tile + 1;
+				else if (b == 0 && ty > 0)
+					neighbour = tile - BEZIER_TILES;
+				else if (b == m_TileSize && ty < BEZIER_TILES - 1)
+					neighbour = tile + BEZIER_TILES;
+				if (neighbour >= 0)
+				{
+					if (m_TileSteps[neighbour] > step || (m_TileSteps[neighbour] == step && neighbour < tile))
+						continue;
+					if (m_TileSteps[neighbour] == step)
+						morph.Tiles[1] = neighbour;
+				}
+
+				morph.Vertex = index(a, b);
+				morph.Active = remap[morph.Vertex];
+				if (morph.Active < 0)
+					continue;
+				// coarser quads are split along tr - bl like the ones above, their centres lie on that diagonal
+				int da = oddA ? step : 0;
+				int db = oddB ? (oddA ? -step : step) : 0;
+				morph.Ends[0] = index(a - da, b - db);
+				morph.Ends[1] = index(a + da, b + db);
+				layout.Morphs.push_back(morph);
+			}
+		}
+	}
+
+	if (m_Mode == BM_CPU)
+		return;
+	// the GPU evaluates the surface at both ends of every vertex
+	int active = layout.ActiveVertices.size();
+	layout.MorphEnds.resize(active * BEZIER_MORPH_ENDS_SIZE);
+	for (int k = 0; k < active; k++)
+	{
+		float* ends = &layout.MorphEnds[k * BEZIER_MORPH_ENDS_SIZE];
+		for (int c = 0; c < 4; c++)
+			ends[c] = layout.Grid[k * 2 + c % 2];
+		ends[4] = -1.f;
+		ends[5] = -1.f;
+	}
+	for (const MorphVertex& morph : layout.Morphs)
+	{
+		float* ends = &layout.MorphEnds[morph.Active * BEZIER_MORPH_ENDS_SIZE];
+		for (int e = 0; e < 2; e++)
+		{
+			ends[e * 2] = (float)(morph.Ends[e] / samples) / m_TriangulationPrecision;
+			ends[e * 2 + 1] = (float)(morph.Ends[e] % samples) / m_TriangulationPrecision;
+			ends[4 + e] = (float)morph.Tiles[e];
+		}
+	}
+}
+
+void Bezier::ResizeActiveHeightSlope(const TileLayout& layout, std::vector<float>& activeHeightSlope) const
+{
+	int samples = m_TriangulationPrecision + 1;
+	// with every vertex used the tessellated grid is uploaded as it is
+	if ((int)layout.ActiveVertices.size() < samples * samples)
+		activeHeightSlope.resize(layout.ActiveVertices.size() * BEZIER_VERTEX_SIZE);
+	else
+		activeHeightSlope.clear();
+}
+
+void Bezier::BuildBasisTables()
+{
+	int n = BEZIER_DEGREE - 1;
+	int samples = m_TriangulationPrecision + 1;
+	m_Basis.resize(samples * BEZIER_DEGREE);
+	m_BasisDerivative.resize(samples * n);
+
+	for (int k = 0; k < samples; k++)
+	{
+		float t = (float)k / m_TriangulationPrecision;
+		for (int i = 0; i <= n; i++)
+			m_Basis[i * samples + k] = B(i, n, t);
+		// d/dt of a degree n curve = n * sum of (P[i + 1] - P[i]) * B(i, n - 1, t)
+		for (int i = 0; i <= n - 1; i++)
+			m_BasisDerivative[i * samples + k] = n * B(i, n - 1, t);
+	}
+}
+
+void Bezier::Tessellate()
+{
+	TessellateInto(m_ControlPoints, m_Layout, m_TileWanted, m_ThreadPool, m_HeightSlope, m_ActiveHeightSlope);
+}
+
+void Bezier::TessellateInto(const float controlPoints[BEZIER_DEGREE][BEZIER_DEGREE], const TileLayout& layout, const float* tileWanted,
+	ThreadPool* pool, std::vector<float>& heightSlope, std::vector<float>& activeHeightSlope)
+{
+	int samples = m_TriangulationPrecision + 1;
+	if (pool == nullptr || pool->GetThreadCount() == 1 || samples < BEZIER_PARALLEL_MIN_ROWS)
+	{
+		TessellateRows(0, samples, controlPoints, layout, heightSlope.data(), activeHeightSlope);
+	}
+	else
+	{
+		int bands = (samples + BEZIER_ROWS_PER_BAND - 1) / BEZIER_ROWS_PER_BAND;
+		auto job = [&, samples, bands](int band)
+		{
+			TessellateRows(samples * band / bands, samples * (band + 1) / bands, controlPoints, layout, heightSlope.data(), activeHeightSlope);
+		};
+		pool->ParallelFor(bands, job);
+	}
+	// ends of the coarser edges can be in rows of other bands
+	MorphVertices(layout, tileWanted, heightSlope, activeHeightSlope);
+}
+
+float Bezier::GetMorphFactor(int step, float wanted) const
+{
+	int quads = m_TileSize / step;
+	if (quads == 1)
+		return 0.f;
+	// like the coarser level wherever that would be enough (and below, over the hysteresis band),
+	// its own heights again the hysteresis ratio above, so switching either way changes nothing on screen
+	float coarse = quads / 2.f;
+	float fine = coarse / BEZIER_LOD_HYSTERESIS;
+	return glm::clamp((fine - wanted) / (fine - coarse), 0.f, 1.f);
+}
+
+bool Bezier::GetMorphFactors(const std::vector<int>& tileSteps, const float* tileWanted, float factors[BEZIER_TILES * BEZIER_TILES]) const
+{
+	bool any = false;
+	for (int tile = 0; tile < BEZIER_TILES * BEZIER_TILES; tile++)
+	{
+		factors[tile] = GetMorphFactor(tileSteps[tile], tileWanted[tile]);
+		any = any || factors[tile] > 0.f;
+	}
+	return any;
+}
+
+void Bezier::MorphVertices(const TileLayout& layout, const float* tileWanted, std::vector<float>& heightSlope, std::vector<float>& activeHeightSlope) const
+{
+	float factors[BEZIER_TILES * BEZIER_TILES];
+	if (!GetMorphFactors(layout.TileSteps, tileWanted, factors))
+		return;
+
+	// ends are read from heightSlope as tessellated, it is only written when every tile has the finest step
+	// and then no end is morphed itself
+	for (const MorphVertex& morph : layout.Morphs)
+	{
+		float factor = factors[morph.Tiles[0]];
+		if (morph.Tiles[1] >= 0)
+			factor = std::max(factor, factors[morph.Tiles[1]]);
+		if (factor == 0.f)
+			continue;
+
+		const float* own = &heightSlope[morph.Vertex * BEZIER_VERTEX_SIZE];
+		const float* end0 = &heightSlope[morph.Ends[0] * BEZIER_VERTEX_SIZE];
+		const float* end1 = &heightSlope[morph.Ends[1] * BEZIER_VERTEX_SIZE];
+		float* vertex = activeHeightSlope.empty() ? &heightSlope[morph.Vertex * BEZIER_VERTEX_SIZE] : &activeHeightSlope[morph.Active * BEZIER_VERTEX_SIZE];
+		// height and both slopes, so the shading blends too
+		for (int c = 0; c < BEZIER_VERTEX_SIZE; c++)
+			vertex[c] = own[c] + factor * (0.5f * (end0[c] + end1[c]) - own[c]);
+	}
+}
+
+void Bezier::TessellateRows(int first, int last, const float controlPoints[BEZIER_DEGREE][BEZIER_DEGREE], const TileLayout& layout,
+	float* heightSlope, std::vector<float>& activeHeightSlope)
+{
+	int n = BEZIER_DEGREE - 1;
+	int samples = m_TriangulationPrecision + 1;
+
+	for (int i = first; i < last; i++)
+	{
+		// no tile uses this row at its current level
+		if (layout.RowStart[i] == layout.RowStart[i + 1])
+			continue;
+
+		// control points collapsed along x for this row: curve in y and its x derivative
+		float curve[BEZIER_DEGREE];
+		float curveDx[BEZIER_DEGREE];
+		for (int j = 0; j <= n; j++)
+		{
+			curve[j] = 0.f;
+			for (int k = 0; k <= n; k++)
+				curve[j] += controlPoints[k][j] * m_Basis[k * samples + i];
+
+			curveDx[j] = 0.f;
+			for (int k = 0; k <= n - 1; k++)
+				curveDx[j] += (controlPoints[k + 1][j] - controlPoints[k][j]) * m_BasisDerivative[k * samples + i];
+		}
+
+		float* row = &heightSlope[i * samples * BEZIER_VERTEX_SIZE];
+		EvaluateBezierRow(curve, curveDx, m_Basis.data(), m_BasisDerivative.data(), samples, row);
+
+		if (activeHeightSlope.empty())
+			continue;
+		// gather the vertices tiles use, they are uploaded as one block
+		for (int k = layout.RowStart[i]; k < layout.RowStart[i + 1]; k++)
+		{
+			const float* vertex = row + (layout.ActiveVertices[k] - i * samples) * BEZIER_VERTEX_SIZE;
+			std::copy(vertex, vertex + BEZIER_VERTEX_SIZE, &activeHeightSlope[k * BEZIER_VERTEX_SIZE]);
+		}
+	}
+}
+
+void Bezier::TessellateDirect()
 {
 	for (int i = 0; i < m_TriangulationPrecision + 1; i++)
 	{
@@ -100,10 +837,6 @@ void Bezier::UpdateArrays()
 			SetVertexN(i, j, newN);
 		}
 	}
-
-	delete m_VB;
-	m_VB = new VertexBuffer(m_PositionTextureNormal.data(), m_PositionTextureNormal.size() * sizeof(float));
-	m_VA->AddBuffer(*m_VB, *m_VBL);
 }
 
 glm::vec3 Bezier::CalN(float x, float y)
@@ -135,6 +868,23 @@ glm::vec3 Bezier::CalN(float x, float y)
 	return N;
 }
 
+float Bezier::CalCurvature(float x, float y)
+{
+	int n = BEZIER_DEGREE - 1;
+	float dxx = 0.f;
+	float dyy = 0.f;
+
+	for (int i = 0; i <= n - 2; i++)
+		for (int j = 0; j <= n; j++)
+			dxx += (m_ControlPoints[i + 2][j] - 2.f * m_ControlPoints[i + 1][j] + m_ControlPoints[i][j]) * B(i, n - 2, x) * B(j, n, y);
+
+	for (int i = 0; i <= n; i++)
+		for (int j = 0; j <= n - 2; j++)
+			dyy += (m_ControlPoints[i][j + 2] - 2.f * m_ControlPoints[i][j + 1] + m_ControlPoints[i][j]) * B(i, n, x) * B(j, n - 2, y);
+
+	return n * (n - 1) * std::max(std::abs(dxx), std::abs(dyy));
+}
+
 float Bezier::B(int i, int n, float t)
 {
 	double a = pow(t, i);
@@ -142,22 +892,16 @@ float Bezier::B(int i, int n, float t)
 	return a * b * factorial(n) / (factorial(i) * factorial(n - i));
 }
 
-float Bezier::GetVertexZ(int i, int j)
-{
-	int index = (i * m_TriangulationPrecision + j) * 8 + 1; // (row * precision + col) * elems_per_vertex + y_index_in_layout
-	return m_PositionTextureNormal[index];
-}
-
 void Bezier::SetVertexZ(int i, int j, float value)
 {
-	int index = (i * m_TriangulationPrecision + j) * 8 + 1; // (row * precision + col) * elems_per_vertex + y_index_in_layout
-	m_PositionTextureNormal[index] = value;
+	int index = (i * (m_TriangulationPrecision + 1) + j) * BEZIER_VERTEX_SIZE; // (row * (precision + 1) + col) * elems_per_vertex + height_index_in_layout
+	m_HeightSlope[index] = value;
 }
 
 void Bezier::SetVertexN(int i, int j, glm::vec3 value)
 {
-	int index = (i * m_TriangulationPrecision + j) * 8 + 5; // (row * precision + col) * elems_per_vertex + normal_x_index_in_layout
-	m_PositionTextureNormal[index] = value.x;
-	m_PositionTextureNormal[index + 1] = value.y;
-	m_PositionTextureNormal[index + 2] = value.z;
+	int index = (i * (m_TriangulationPrecision + 1) + j) * BEZIER_VERTEX_SIZE + 1; // (row * (precision + 1) + col) * elems_per_vertex + slope_x_index_in_layout
+	// value = normalize(-dx, 1, -dy)
+	m_HeightSlope[index] = -value.x / value.y;
+	m_HeightSlope[index + 1] = -value.z / value.y;
 }
@@ -0,0 +1,105 @@
+#include "../Public/BezierKernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BEZIER_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BEZIER_SIMD_WIDTH 4
+#else
+#define BEZIER_SIMD_WIDTH 1
+#endif
+
+// plain version, also handles what is left after the vector loop
+static void EvaluateBezierRowScalar(const float* curve, const float* curveDx, const float* basis, const float* basisDerivative,
+	int samples, int first, float* vertices)
+{
+	const int n = BEZIER_DEGREE - 1;
+	float* vertex = vertices + first * BEZIER_VERTEX_SIZE;
+	for (int j = first; j < samples; j++, vertex += BEZIER_VERTEX_SIZE)
+	{
+		float z = 0.f;
+		float dx = 0.f;
+		float dy = 0.f;
+		for (int k = 0; k <= n; k++)
+		{
+			z += curve[k] * basis[k * samples + j];
+			dx += curveDx[k] * basis[k * samples + j];
+		}
+		for (int k = 0; k <= n - 1; k++)
+			dy += (curve[k + 1] - curve[k]) * basisDerivative[k * samples + j];
+
+		vertex[0] = z;
+		vertex[1] = dx;
+		vertex[2] = dy;
+	}
+}
+
+#if BEZIER_SIMD_WIDTH == 8
+typedef __m256 simd;
+#define SIMD_SET1 _mm256_set1_ps
+#define SIMD_LOAD _mm256_loadu_ps
+#define SIMD_STORE _mm256_storeu_ps
+#define SIMD_ADD _mm256_add_ps
+#define SIMD_MUL _mm256_mul_ps
+#elif BEZIER_SIMD_WIDTH == 4
+typedef __m128 simd;
+#define SIMD_SET1 _mm_set1_ps
+#define SIMD_LOAD _mm_loadu_ps
+#define SIMD_STORE _mm_storeu_ps
+#define SIMD_ADD _mm_add_ps
+#define SIMD_MUL _mm_mul_ps
+#endif
+
+void EvaluateBezierRow(const float* curve, const float* curveDx, const float* basis, const float* basisDerivative,
+	int samples, float* vertices)
+{
+	int j = 0;
+#if BEZIER_SIMD_WIDTH > 1
+	const int n = BEZIER_DEGREE - 1;
+	simd c[BEZIER_DEGREE];
+	simd cDx[BEZIER_DEGREE];
+	simd cDy[BEZIER_DEGREE - 1];
+	for (int k = 0; k <= n; k++)
+	{
+		c[k] = SIMD_SET1(curve[k]);
+		cDx[k] = SIMD_SET1(curveDx[k]);
+	}
+	for (int k = 0; k <= n - 1; k++)
+		cDy[k] = SIMD_SET1(curve[k + 1] - curve[k]);
+
+	const simd zero = SIMD_SET1(0.f);
+
+	float z[BEZIER_SIMD_WIDTH];
+	float zDx[BEZIER_SIMD_WIDTH];
+	float zDy[BEZIER_SIMD_WIDTH];
+
+	for (; j + BEZIER_SIMD_WIDTH <= samples; j += BEZIER_SIMD_WIDTH)
+	{
+		simd height = zero;
+		simd dx = zero;
+		simd dy = zero;
+		for (int k = 0; k <= n; k++)
+		{
+			simd b = SIMD_LOAD(basis + k * samples + j);
+			height = SIMD_ADD(height, SIMD_MUL(c[k], b));
+			dx = SIMD_ADD(dx, SIMD_MUL(cDx[k], b));
+		}
+		for (int k = 0; k <= n - 1; k++)
+			dy = SIMD_ADD(dy, SIMD_MUL(cDy[k], SIMD_LOAD(basisDerivative + k * samples + j)));
+
+		SIMD_STORE(z, height);
+		SIMD_STORE(zDx, dx);
+		SIMD_STORE(zDy, dy);
+
+		float* vertex = vertices + j * BEZIER_VERTEX_SIZE;
+		for (int l = 0; l < BEZIER_SIMD_WIDTH; l++, vertex += BEZIER_VERTEX_SIZE)
+		{
+			vertex[0] = z[l];
+			vertex[1] = zDx[l];
+			vertex[2] = zDy[l];
+		}
+	}
+#endif
+	EvaluateBezierRowScalar(curve, curveDx, basis, basisDerivative, samples, j, vertices);
+}
@@ -0,0 +1,230 @@
+#include "../Public/BezierTerrain.h"
+#include "../Public/Bezier.h"
+#include "../Public/VertexArray.h"
+#include "../Public/VertexBuffer.h"
+#include "../Public/VertexBufferLayout.h"
+#include "../Public/MeshOptimizer.h"
+#include <algorithm>
+
+// power form and differences below are written for cubic patches
+static_assert(BEZIER_DEGREE == 4, "BezierTerrain supports bicubic patches only");
+
+// smaller surfaces are tessellated on the calling thread, waking workers would cost more than it saves
+#define BEZIER_TERRAIN_PARALLEL_MIN_VERTICES 16384
+
+// cubic Bernstein basis in power form: B(k, 3, t) = sum of s_BernsteinToPower[p][k] * t^p
+static const float s_BernsteinToPower[BEZIER_DEGREE][BEZIER_DEGREE] = {
+	{ 1.f, 0.f, 0.f, 0.f },
+	{ -3.f, 3.f, 0.f, 0.f },
+	{ 3.f, -6.f, 3.f, 0.f },
+	{ -1.f, 3.f, -3.f, 1.f }
+};
+
+// Starting value and forward differences of c[0] + c[1] t + c[2] t^2 + c[3] t^3 at t = 0 with step h,
+// after that every next sample is three adds: f[0] += f[1]; f[1] += f[2]; f[2] += f[3]
+static void CubicDifferences(const float* c, float h, float* f)
+{
+	float h2 = h * h;
+	float h3 = h2 * h;
+	f[0] = c[0];
+	f[1] = c[1] * h + c[2] * h2 + c[3] * h3;
+	f[2] = 2.f * c[2] * h2 + 6.f * c[3] * h3;
+	f[3] = 6.f * c[3] * h3;
+}
+
+// the same for c[0] + c[1] t + c[2] t^2, two adds per sample
+static void QuadraticDifferences(const float* c, float h, float* f)
+{
+	float h2 = h * h;
+	f[0] = c[0];
+	f[1] = c[1] * h + c[2] * h2;
+	f[2] = 2.f * c[2] * h2;
+}
+
+BezierTerrain::BezierTerrain(int patchesX, int patchesY, int precision, bool strips) :
+	m_PatchesX(patchesX), m_PatchesY(patchesY), m_Precision(precision), m_ThreadPool(&ThreadPool::GetShared())
+{
+	int rows = m_PatchesX * m_Precision + 1;
+	m_Columns = m_PatchesY * m_Precision + 1;
+	m_ControlPoints.resize((3 * m_PatchesX + 1) * (3 * m_PatchesY + 1));
+	m_HeightSlope.resize(rows * m_Columns * BEZIER_VERTEX_SIZE);
+
+	m_VA = new VertexArray();
+	m_VBL = new VertexBufferLayout();
+
+	// flat (x, y) grid, one unit per patch, also texture coordinate
+	std::vector<float> grid;
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < m_Columns; j++)
+		{
+			grid.push_back((float)i / m_Precision);
+			grid.push_back((float)j / m_Precision);
+		}
+	}
+	m_VB = new VertexBuffer(grid.data(), grid.size() * sizeof(float));
+
+	// surface coords
+	m_VBL->Push<float>(2);
+	m_VA->AddBuffer(*m_VB, *m_VBL);
+
+	UpdateControlPoints();
+	UpdateBounds();
+	Tessellate();
+
+	m_DynamicVB = new VertexBuffer(m_HeightSlope.data(), m_HeightSlope.size() * sizeof(float), GL_STREAM_DRAW);
+	m_DynamicVBL = new VertexBufferLayout();
+	// height, dHeight/dx, dHeight/dy
+	m_DynamicVBL->Push<float>(3);
+	m_VA->AddBuffer(*m_DynamicVB, *m_DynamicVBL);
+
+	// index buffer, walked in bands that keep shared vertices in the post-transform cache
+	std::vector<uint> indices = BuildGridIndices(rows, m_Columns, strips);
+	m_IB = new IndexBuffer(indices.data(), indices.size(), strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES);
+}
+
+BezierTerrain::~BezierTerrain()
+{
+	delete m_DynamicVB;
+	delete m_DynamicVBL;
+}
+
+void BezierTerrain::Tick(float interval)
+{
+	m_Time += interval;
+	UpdateControlPoints();
+	UpdateBounds();
+	Tessellate();
+	m_DynamicVB->Update(m_HeightSlope.data(), m_HeightSlope.size() * sizeof(float));
+}
+
+void BezierTerrain::UpdateControlPoints()
+{
+	int rows = 3 * m_PatchesX + 1;
+	int columns = 3 * m_PatchesY + 1;
+
+	// every point waves with its own speed and phase
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < columns; j++)
+		{
+			float speed = 0.02f + 0.08f * fmodf(i * 0.37f + j * 0.61f, 1.f);
+			float phase = i * 1.7f + j * 2.3f;
+			m_ControlPoints[i * columns + j] = m_MaxHeight * sinf(m_Time * speed + phase);
+		}
+	}
+
+	// C1 seams: point on a seam is the midpoint of its neighbours across it, so the neighbours and the seam point are
+	// collinear and equally spaced. Seams along y first, then along x, which keeps the first ones valid too.
+	for (int j = 3; j < columns - 1; j += 3)
+		for (int i = 0; i < rows; i++)
+			m_ControlPoints[i * columns + j] = 0.5f * (m_ControlPoints[i * columns + j - 1] + m_ControlPoints[i * columns + j + 1]);
+
+	for (int i = 3; i < rows - 1; i += 3)
+		for (int j = 0; j < columns; j++)
+			m_ControlPoints[i * columns + j] = 0.5f * (m_ControlPoints[(i - 1) * columns + j] + m_ControlPoints[(i + 1) * columns + j]);
+}
+
+void BezierTerrain::UpdateBounds()
+{
+	auto heights = std::minmax_element(m_ControlPoints.begin(), m_ControlPoints.end());
+	SetBounds(glm::vec3(0.f, *heights.first, 0.f), glm::vec3((float)m_PatchesX, *heights.second, (float)m_PatchesY));
+}
+
+float BezierTerrain::CalZ(float x, float y) const
+{
+	int px = std::min(std::max((int)x, 0), m_PatchesX - 1);
+	int py = std::min(std::max((int)y, 0), m_PatchesY - 1);
+	float u = x - px;
+	float v = y - py;
+
+	float z = 0.f;
+	for (int i = 0; i < BEZIER_DEGREE; i++)
+		for (int j = 0; j < BEZIER_DEGREE; j++)
+			z += GetControlPoint(3 * px + i, 3 * py + j) * Bezier::B(i, BEZIER_DEGREE - 1, u) * Bezier::B(j, BEZIER_DEGREE - 1, v);
+	return z;
+}
+
+void BezierTerrain::Tessellate()
+{
+	int patches = m_PatchesX * m_PatchesY;
+	if (m_ThreadPool == nullptr || m_ThreadPool->GetThreadCount() == 1 || GetVertexCount() < BEZIER_TERRAIN_PARALLEL_MIN_VERTICES)
+	{
+		for (int p = 0; p < patches; p++)
+			TessellatePatch(p / m_PatchesY, p % m_PatchesY);
+		return;
+	}
+
+	auto job = [this](int patch)
+	{
+		TessellatePatch(patch / m_PatchesY, patch % m_PatchesY);
+	};
+	m_ThreadPool->ParallelFor(patches, job);
+}
+
+void BezierTerrain::TessellatePatch(int px, int py)
+{
+	const int n = BEZIER_DEGREE - 1;
+	float h = 1.f / m_Precision;
+
+	// patch in power form: z(u, v) = sum of a[i][j] * u^i * v^j
+	float a[BEZIER_DEGREE][BEZIER_DEGREE] = { 0 };
+	for (int i = 0; i <= n; i++)
+		for (int j = 0; j <= n; j++)
+			for (int k = 0; k <= n; k++)
+				for (int l = 0; l <= n; l++)
+					a[i][j] += s_BernsteinToPower[i][k] * GetControlPoint(3 * px + k, 3 * py + l) * s_BernsteinToPower[j][l];
+
+	// across rows: coefficients of v^j are cubics in u, their u derivatives quadratics, both stepped by differences
+	float curve[BEZIER_DEGREE][BEZIER_DEGREE];
+	float curveDx[BEZIER_DEGREE][BEZIER_DEGREE - 1];
+	for (int j = 0; j <= n; j++)
+	{
+		float c[BEZIER_DEGREE] = { a[0][j], a[1][j], a[2][j], a[3][j] };
+		float dc[BEZIER_DEGREE - 1] = { a[1][j], 2.f * a[2][j], 3.f * a[3][j] };
+		CubicDifferences(c, h, curve[j]);
+		QuadraticDifferences(dc, h, curveDx[j]);
+	}
+
+	// seam vertices are written by the patch before, so no two threads write the same vertex
+	int firstRow = px > 0 ? 1 : 0;
+	int firstColumn = py > 0 ? 1 : 0;
+
+	for (int r = 0; r <= m_Precision; r++)
+	{
+		if (r >= firstRow)
+		{
+			// along the row: height and dHeight/dx are cubics in v, dHeight/dy a quadratic
+			float row[BEZIER_DEGREE] = { curve[0][0], curve[1][0], curve[2][0], curve[3][0] };
+			float rowDx[BEZIER_DEGREE] = { curveDx[0][0], curveDx[1][0], curveDx[2][0], curveDx[3][0] };
+			float rowDy[BEZIER_DEGREE - 1] = { row[1], 2.f * row[2], 3.f * row[3] };
+
+			float z[BEZIER_DEGREE];
+			float dx[BEZIER_DEGREE];
+			float dy[BEZIER_DEGREE - 1];
+			CubicDifferences(row, h, z);
+			CubicDifferences(rowDx, h, dx);
+			QuadraticDifferences(rowDy, h, dy);
+
+			float* vertex = &m_HeightSlope[((px * m_Precision + r) * m_Columns + py * m_Precision) * BEZIER_VERTEX_SIZE];
+			for (int k = 0; k <= m_Precision; k++, vertex += BEZIER_VERTEX_SIZE)
+			{
+				if (k >= firstColumn)
+				{
+					vertex[0] = z[0];
+					vertex[1] = dx[0];
+					vertex[2] = dy[0];
+				}
+				z[0] += z[1]; z[1] += z[2]; z[2] += z[3];
+				dx[0] += dx[1]; dx[1] += dx[2]; dx[2] += dx[3];
+				dy[0] += dy[1]; dy[1] += dy[2];
+			}
+		}
+
+		for (int j = 0; j <= n; j++)
+		{
+			curve[j][0] += curve[j][1]; curve[j][1] += curve[j][2]; curve[j][2] += curve[j][3];
+			curveDx[j][0] += curveDx[j][1]; curveDx[j][1] += curveDx[j][2];
+		}
+	}
+}
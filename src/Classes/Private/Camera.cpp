@@ -166,6 +166,7 @@ void Camera::UpdateMatrix()
 	projection = glm::perspective(m_FOVdeg, (float)m_WindowWidth / m_WindowHeight, m_NearPlane, m_FarPlane);
 
 	m_CameraMatrix = projection * view;
+	m_Frustum = Frustum(m_CameraMatrix);
 }
 
 void Camera::Scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
@@ -1,7 +1,11 @@
 #include "../Public/ChessBoard.h"
 #include "../Public/Bezier.h"
+#include "../Public/Camera.h"
+#include "../Public/RenderQueue.h"
+#include "../Public/OcclusionQueries.h"
 
 std::map<int, std::shared_ptr<Model>> ChessBoard::piecesModelsMap = {};
+PieceInstances ChessBoard::s_PieceInstances;
 
 ChessBoard::ChessBoard(std::shared_ptr<Mesh> Mesh, std::shared_ptr<Texture> Tex, glm::vec3 pos) : Model(Mesh, Tex, pos)
 {
@@ -14,24 +18,52 @@ ChessBoard::~ChessBoard()
 
 float ChessBoard::GetZ(int i, int j) const
 {
-	Bezier* bezier = (Bezier*)m_Mesh.get();
-	int w = bezier->m_TriangulationPrecision / (SIZE * 2);
-	int x = w + w * 2 * i;
-	int y = w + w * 2 * (7 - j);
-	return bezier->GetVertexZ(x, y);
+	// rows go along the first surface coordinate, columns along the second, one tile per square
+	return ((Bezier*)m_Mesh.get())->GetTileHeight(i, j);
+}
+
+glm::vec3 ChessBoard::GetNormal(int i, int j) const
+{
+	glm::vec3 normal = ((Bezier*)m_Mesh.get())->GetTileNormal(i, j);
+	return glm::normalize(glm::mat3(GetModelMatrix()) * normal);
 }
 
 void ChessBoard::Tick(float interval)
 {
-	((Bezier*)m_Mesh.get())->Tick(interval);
+	Bezier* bezier = (Bezier*)m_Mesh.get();
+	// tile levels for the camera the next frame is drawn with, before Tick tessellates them
+	if (Camera::m_CurrCam != nullptr)
+		bezier->UpdateLevelOfDetail(Camera::m_CurrCam->GetCameraMatrix() * GetModelMatrix(), (float)Camera::m_CurrCam->GetWindowHeight());
+	bezier->Tick(interval);
 }
 
-void ChessBoard::Draw(const Renderer& renderer, Shader& shader) const
+void ChessBoard::SetUniforms(Shader& shader, bool modelMatrix) const
 {
-	shader.SetUniform4f("u_Color", 0.4f, 0.4f, 0.4f, 1.f);
-	Model::Draw(shader);
+	Model::SetUniforms(shader, modelMatrix);
 
+	// the shared Phong shader draws a BM_CPU board without any surface uniforms
+	if (m_SurfaceShader == nullptr)
+		return;
+	((Bezier*)m_Mesh.get())->SetUniforms(shader);
+	// tessellation levels follow the camera the board is seen from
+	if (((Bezier*)m_Mesh.get())->GetMode() == BM_Tessellation && Camera::m_CurrCam != nullptr)
+		shader.SetUniform3f("u_CameraPos", Camera::m_CurrCam->GetPosition());
+}
+
+void ChessBoard::Submit(RenderQueue& queue, Shader& shader) const
+{
+	queue.Submit(*this, m_SurfaceShader != nullptr ? *m_SurfaceShader : shader, glm::vec4(0.4f, 0.4f, 0.4f, 1.f));
 
+	if (m_PieceShader != nullptr)
+	{
+		AddPieceInstances(s_PieceInstances);
+		SubmitPieces(s_PieceInstances, *m_PieceShader, queue);
+	}
+}
+
+void ChessBoard::AddPieceInstances(PieceInstances& instances) const
+{
+	m_OccludedSquares.clear();
 	for (int i = 0; i < SIZE; i++)
 	{
 		for (int j = 0; j < SIZE; j++)
@@ -39,16 +71,91 @@ void ChessBoard::Draw(const Renderer& renderer, Shader& shader) const
 			if (m_Board[i][j].first == None)
 				continue;
 
-		 	ChessBoard::piecesModelsMap[m_Board[i][j].first]->SetPosition(glm::vec3(m_A1Position.x + j*1.f, m_A1Position.y + GetZ(i, j) * 8, m_A1Position.z - i * 1.f));
-			shader.Bind();
+			const std::shared_ptr<Model>& piece = ChessBoard::piecesModelsMap[m_Board[i][j].first];
+			MeshInstance instance;
+			// stands perpendicular to the surface
+			instance.Model = piece->GetModelMatrix(glm::vec3(m_A1Position.x + j*1.f, m_A1Position.y + GetZ(i, j) * GetScale().y, m_A1Position.z - i * 1.f), GetNormal(i, j));
 			if (m_Board[i][j].second == false) // White piece
-				shader.SetUniform4f("u_Color", 0.8f, 0.8f, 0.8f, 1.f);
+				instance.Color = glm::vec4(0.8f, 0.8f, 0.8f, 1.f);
 			else // Black piece
-				shader.SetUniform4f("u_Color", 0.4f, 0.4f, 0.4f, 1.f);
+				instance.Color = glm::vec4(0.4f, 0.4f, 0.4f, 1.f);
+
+			m_PieceLods[i][j] = piece->SelectLod(m_PieceLods[i][j], instance.Model);
+			m_PieceInstances[i][j] = instance;
+			// results of the last frame, so nothing waits for the GPU
+			if (m_Occlusion != nullptr && m_Occlusion->IsOccluded(i * SIZE + j))
+			{
+				m_OccludedSquares.push_back(i * SIZE + j);
+				continue;
+			}
+			PieceGroup& group = instances[m_Board[i][j].first];
+			group.Instances.push_back(instance);
+			// a piece the queue culls doesn't make the others finer
+			if (Camera::m_CurrCam == nullptr || piece->IsVisible(Camera::m_CurrCam->GetFrustum(), instance.Model))
+				group.Lod = std::min(group.Lod, m_PieceLods[i][j]);
+		}
+	}
+}
+
+void ChessBoard::SubmitPieces(PieceInstances& instances, Shader& instancedShader, RenderQueue& queue)
+{
+	for (auto& group : instances)
+	{
+		if (group.second.Instances.empty())
+			continue;
+
+		// every piece is off screen when no level was picked, the queue culls them all
+		queue.SubmitInstanced(*ChessBoard::piecesModelsMap[group.first], instancedShader, std::min(group.second.Lod, (uint)MESH_MAX_LODS - 1),
+			group.second.Instances);
+		group.second.Instances.clear();
+		group.second.Lod = MESH_MAX_LODS;
+	}
+}
 
-			ChessBoard::piecesModelsMap[m_Board[i][j].first]->Draw(shader);
+void ChessBoard::DrawOcclusionPass() const
+{
+	if (m_Occlusion == nullptr || m_PieceShader == nullptr)
+		return;
+
+	bool onScreen[SIZE][SIZE] = {};
+	m_Occlusion->Begin();
+	for (int i = 0; i < SIZE; i++)
+	{
+		for (int j = 0; j < SIZE; j++)
+		{
+			if (m_Board[i][j].first == None)
+				continue;
+
+			const Model& piece = *ChessBoard::piecesModelsMap[m_Board[i][j].first];
+			// pieces outside of the frustum come back through the groups, where the queue culls them
+			if (Camera::m_CurrCam != nullptr && !piece.IsVisible(Camera::m_CurrCam->GetFrustum(), m_PieceInstances[i][j].Model))
+			{
+				m_Occlusion->Reset(i * SIZE + j);
+				continue;
+			}
+			onScreen[i][j] = true;
+			m_Occlusion->Query(i * SIZE + j, piece, m_PieceInstances[i][j].Model);
 		}
 	}
+	m_Occlusion->End();
+
+	// after all boxes, so the GPU usually has the results by the time it gets to the pieces
+	m_PieceShader->Bind();
+	for (int square : m_OccludedSquares)
+	{
+		int i = square / SIZE;
+		int j = square % SIZE;
+		if (!onScreen[i][j])
+			continue;
+
+		const Model& piece = *ChessBoard::piecesModelsMap[m_Board[i][j].first];
+		const Mesh& mesh = *piece.GetMesh();
+		piece.Bind();
+		piece.SetUniforms(*m_PieceShader, false);
+		m_Occlusion->BeginConditional(square);
+		mesh.DrawInstanced(std::min(m_PieceLods[i][j], mesh.GetLodCount() - 1), &m_PieceInstances[i][j], 1);
+		m_Occlusion->EndConditional(square);
+	}
 }
 
 void ChessBoard::AddPiece(int type, bool colour, int column, int row)
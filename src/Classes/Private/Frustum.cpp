@@ -0,0 +1,53 @@
+#include "../Public/Frustum.h"
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < 6; i++)
+		m_Planes[i] = glm::vec4(0.f, 0.f, 0.f, 1.f);
+}
+
+Frustum::Frustum(const glm::mat4& cameraMatrix)
+{
+	// a point is inside when -w <= x, y, z <= w in clip space, each inequality is a plane of the rows of the matrix
+	glm::vec4 rowX(cameraMatrix[0][0], cameraMatrix[1][0], cameraMatrix[2][0], cameraMatrix[3][0]);
+	glm::vec4 rowY(cameraMatrix[0][1], cameraMatrix[1][1], cameraMatrix[2][1], cameraMatrix[3][1]);
+	glm::vec4 rowZ(cameraMatrix[0][2], cameraMatrix[1][2], cameraMatrix[2][2], cameraMatrix[3][2]);
+	glm::vec4 rowW(cameraMatrix[0][3], cameraMatrix[1][3], cameraMatrix[2][3], cameraMatrix[3][3]);
+
+	m_Planes[0] = rowW + rowX;
+	m_Planes[1] = rowW - rowX;
+	m_Planes[2] = rowW + rowY;
+	m_Planes[3] = rowW - rowY;
+	m_Planes[4] = rowW + rowZ;
+	m_Planes[5] = rowW - rowZ;
+
+	// unit normals make the plane equation a distance, comparable with radii
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(m_Planes[i]));
+		if (length > 0.f)
+			m_Planes[i] /= length;
+	}
+}
+
+bool Frustum::IntersectsSphere(glm::vec3 centre, float radius) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(m_Planes[i]), centre) + m_Planes[i].w < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::IntersectsBox(glm::vec3 centre, glm::vec3 extent) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		// the box corner furthest along the normal is still behind the plane
+		glm::vec3 normal(m_Planes[i]);
+		if (glm::dot(normal, centre) + glm::dot(glm::abs(normal), extent) + m_Planes[i].w < 0.f)
+			return false;
+	}
+	return true;
+}
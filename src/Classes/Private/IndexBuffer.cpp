@@ -1,26 +1,81 @@
 #include "../Public/IndexBuffer.h"
 #include "../Public/Renderer.h"
 
-IndexBuffer::IndexBuffer(const uint* data, uint count) : m_Count(count)
+IndexBuffer::IndexBuffer(const uint* data, uint count, uint mode) : m_Count(0), m_Type(GL_UNSIGNED_INT), m_Mode(mode)
 {
 	ASSERT(sizeof(uint) == sizeof(GLuint));
 
 	GLCall(glGenBuffers(1, &m_Renderer_ID));
-	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Renderer_ID));
-	GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(uint), data, GL_STATIC_DRAW));
+	Upload(data, count, GL_STATIC_DRAW);
+}
+
+IndexBuffer::IndexBuffer(const void* data, uint count, uint type, uint mode) : m_Count(count), m_Type(type), m_Mode(mode)
+{
+	GLCall(glGenBuffers(1, &m_Renderer_ID));
+	Bind();
+	GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)count * GetTypeSize(type), data, GL_STATIC_DRAW));
 }
 
 IndexBuffer::~IndexBuffer()
 {
 	GLCall(glDeleteBuffers(1, &m_Renderer_ID));
+	Renderer::ForgetElementBuffer(m_Renderer_ID);
+}
+
+void IndexBuffer::Update(const uint* data, uint count)
+{
+	Upload(data, count, GL_DYNAMIC_DRAW);
+}
+
+void IndexBuffer::Upload(const uint* data, uint count, uint usage)
+{
+	m_Count = count;
+
+	// 0xFFFF is left for the restart index
+	uint maxIndex = 0;
+	for (uint i = 0; i < count; i++)
+		if (data[i] != INDEX_RESTART && data[i] > maxIndex)
+			maxIndex = data[i];
+
+	Bind();
+	if (maxIndex < 0xFFFF)
+	{
+		// half the memory and index fetch bandwidth
+		m_Type = GL_UNSIGNED_SHORT;
+		std::vector<unsigned short> shortData(data, data + count);
+		GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned short), shortData.data(), usage));
+	}
+	else
+	{
+		m_Type = GL_UNSIGNED_INT;
+		GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(uint), data, usage));
+	}
+}
+
+std::vector<uint> IndexBuffer::ReadIndices() const
+{
+	std::vector<uint> indices(m_Count);
+	Bind();
+	if (m_Type == GL_UNSIGNED_SHORT)
+	{
+		std::vector<unsigned short> shortData(m_Count);
+		GLCall(glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, m_Count * sizeof(unsigned short), shortData.data()));
+		for (uint i = 0; i < m_Count; i++)
+			indices[i] = shortData[i] == 0xFFFF ? INDEX_RESTART : shortData[i];
+	}
+	else
+	{
+		GLCall(glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, m_Count * sizeof(uint), indices.data()));
+	}
+	return indices;
 }
 
 void IndexBuffer::Bind() const
 {
-	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Renderer_ID));
+	Renderer::BindElementBuffer(m_Renderer_ID);
 }
 
 void IndexBuffer::UnBind() const
 {
-	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+	Renderer::BindElementBuffer(0);
 }
@@ -0,0 +1,70 @@
+#include "../Public/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		return;
+
+	m_Mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_Mapping == NULL)
+		return;
+
+	m_Data = (const uchar*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_Data != nullptr)
+		m_Size = (size_t)size.QuadPart;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data != nullptr)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping != nullptr)
+		CloseHandle(m_Mapping);
+	if (m_File != nullptr)
+		CloseHandle(m_File);
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+	m_File = open(path.c_str(), O_RDONLY);
+	if (m_File < 0)
+		return;
+
+	struct stat info;
+	if (fstat(m_File, &info) != 0 || info.st_size == 0)
+		return;
+
+	void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, m_File, 0);
+	if (data == MAP_FAILED)
+		return;
+
+	m_Data = (const uchar*)data;
+	m_Size = info.st_size;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data != nullptr)
+		munmap((void*)m_Data, m_Size);
+	if (m_File >= 0)
+		close(m_File);
+}
+#endif
@@ -1,91 +1,277 @@
 #include "../Public/Mesh.h"
+#include "../Public/Renderer.h"
 #include "../Public/VertexArray.h"
 #include "../Public/VertexBuffer.h"
 #include "../Public/VertexBufferLayout.h"
+#include "../Public/MappedFile.h"
+#include "../Public/MeshOptimizer.h"
 #include <assimp/postprocess.h>
 #include <assimp/Importer.hpp>
+#include <glm/gtc/packing.hpp>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
 
 
-void Mesh::ProcessNode(aiNode* node, const aiScene* scene)
+// floats per vertex of imported meshes: position 3, texture coordinate 2, normal 3
+#define MESH_IMPORT_VERTEX_SIZE 8
+// bytes per vertex of QuantizeVertices
+#define MESH_QUANTIZED_VERTEX_BYTES 16
+
+bool Mesh::s_QuantizeImport = true;
+uint Mesh::s_DrawnIndices = 0;
+
+// every level of detail has at most this part of the triangles of the level before
+#define MESH_LOD_REDUCTION 0.5f
+// levels that couldn't get below this part of the level before aren't worth a switch
+#define MESH_LOD_MIN_REDUCTION 0.8f
+
+// Binary cache written next to the source on the first import: header, submeshes, interleaved vertices, indices (of IndexType).
+// Bump MESH_CACHE_VERSION when the import (flags, layout) or the format changes, older caches are imported again.
+#define MESH_CACHE_EXTENSION ".meshcache"
+#define MESH_CACHE_VERSION 6
+#define MESH_CACHE_MAX_ATTRIBUTES 8
+
+struct MeshCacheAttribute
+{
+    uint Type;
+    uint Count;
+    uint Normalized;
+};
+
+struct MeshCacheHeader
+{
+    char Magic[4];
+    uint Version;
+    // FNV-1a of the source file the cache was imported from
+    unsigned long long SourceHash;
+    uint VertexCount;
+    uint IndexCount;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, as uploaded
+    uint IndexType;
+    uint AttributeCount;
+    MeshCacheAttribute Attributes[MESH_CACHE_MAX_ATTRIBUTES];
+    // vertices packed by QuantizeVertices
+    uint Quantized;
+    uint SubMeshCount;
+    float BoundsMin[3];
+    float BoundsMax[3];
+    float BoundingCentre[3];
+    float BoundingRadius;
+};
+
+static void PushImportLayout(VertexBufferLayout& layout, bool quantized)
+{
+    // positions, texture, normals, locations 0, 1, 2 of the shaders
+    if (quantized)
+    {
+        // fourth component pads the position to 8 bytes
+        layout.Push<ushort>(4);
+        layout.Push<half>(2);
+        layout.Push<short>(2);
+        return;
+    }
+    layout.Push<float>(3);
+    layout.Push<float>(2);
+    layout.Push<float>(3);
+}
+
+// unit vector folded onto the octahedron |x| + |y| + |z| = 1 and its lower half unfolded over the upper one, in [-1, 1]^2
+static glm::vec2 EncodeOctahedral(glm::vec3 normal)
+{
+    float sum = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if (sum == 0.f)
+        return glm::vec2(0.f);
+    glm::vec2 encoded = glm::vec2(normal.x, normal.y) / sum;
+    if (normal.z < 0.f)
+    {
+        glm::vec2 sign(encoded.x >= 0.f ? 1.f : -1.f, encoded.y >= 0.f ? 1.f : -1.f);
+        encoded = (1.f - glm::abs(glm::vec2(encoded.y, encoded.x))) * sign;
+    }
+    return encoded;
+}
+
+// Import layout floats to 16 bytes a vertex: position as 16-bit fractions of the bounds, texture coordinate as half floats
+// (repeating coordinates outside [0, 1] keep working), normal octahedral in two 16-bit snorms. Decoded in the shaders with
+// the uniforms from Mesh::SetDecodeUniforms.
+static void QuantizeVertices(const std::vector<float>& vertices, glm::vec3 boundsMin, glm::vec3 boundsMax, std::vector<uchar>& quantized)
+{
+    struct QuantizedVertex
+    {
+        ushort Position[4];
+        ushort TexCoord[2];
+        short Normal[2];
+    };
+    static_assert(sizeof(QuantizedVertex) == MESH_QUANTIZED_VERTEX_BYTES, "quantized vertex has to match PushImportLayout");
+
+    glm::vec3 extent = boundsMax - boundsMin;
+    uint vertexCount = vertices.size() / MESH_IMPORT_VERTEX_SIZE;
+    quantized.resize(vertexCount * sizeof(QuantizedVertex));
+    QuantizedVertex* out = (QuantizedVertex*)quantized.data();
+
+    for (uint i = 0; i < vertexCount; i++)
+    {
+        const float* vertex = &vertices[i * MESH_IMPORT_VERTEX_SIZE];
+        for (int k = 0; k < 3; k++)
+        {
+            float fraction = extent[k] > 0.f ? (vertex[k] - boundsMin[k]) / extent[k] : 0.f;
+            out[i].Position[k] = (ushort)(glm::clamp(fraction, 0.f, 1.f) * 65535.f + 0.5f);
+        }
+        out[i].Position[3] = 0;
+        out[i].TexCoord[0] = glm::packHalf1x16(vertex[3]);
+        out[i].TexCoord[1] = glm::packHalf1x16(vertex[4]);
+
+        glm::vec2 normal = EncodeOctahedral(glm::make_vec3(&vertex[5]));
+        out[i].Normal[0] = (short)roundf(glm::clamp(normal.x, -1.f, 1.f) * 32767.f);
+        out[i].Normal[1] = (short)roundf(glm::clamp(normal.y, -1.f, 1.f) * 32767.f);
+    }
+}
+
+// 0 when the file can't be read
+static unsigned long long HashFile(const std::string& path)
+{
+    MappedFile file(path);
+    if (file.GetData() == nullptr)
+        return 0;
+
+    unsigned long long hash = 14695981039346656037ull;
+    for (size_t i = 0; i < file.GetSize(); i++)
+    {
+        hash ^= file.GetData()[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void Mesh::ProcessNode(aiNode* node, const aiScene* scene, MeshData& data, MeshOptimizeStats& stats)
 {
     // Process each mesh located at the current node
     for (uint i = 0; i < node->mNumMeshes; i++)
     {
         // The node object only contains indices to index the actual objects in the scene.
         // The scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-        aiMesh* mesh = scene->mMeshes[i];
+        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 
-        ProcessMesh(mesh);
+        ProcessMesh(mesh, data, stats);
     }
 
     // After we've processed all of the meshes (if any) we then recursively process each of the children nodes
     for (uint i = 0; i < node->mNumChildren; i++)
     {
-        this->ProcessNode(node->mChildren[i], scene);
+        ProcessNode(node->mChildren[i], scene, data, stats);
     }
 }
 
-void Mesh::ProcessMesh(aiMesh* mesh)
+void Mesh::ProcessMesh(aiMesh* mesh, MeshData& data, MeshOptimizeStats& stats)
 {
-    std::vector<float> position_texture_normal;
-
-    // Walk through each of the mesh's vertices
+    // the submesh is optimized and simplified on its own, then appended to the shared vertices and indices
+    std::vector<float> vertices(mesh->mNumVertices * MESH_IMPORT_VERTEX_SIZE);
     for (uint i = 0; i < mesh->mNumVertices; i++)
     {
-        position_texture_normal.push_back(mesh->mVertices[i].x);
-        position_texture_normal.push_back(mesh->mVertices[i].y);
-        position_texture_normal.push_back(mesh->mVertices[i].z);
-
-        // Texture Coordinates
-        if (mesh->mTextureCoords[0]) // Does the mesh contain texture coordinates?
-        {
-            position_texture_normal.push_back(mesh->mTextureCoords[0][i].x);
-            position_texture_normal.push_back(mesh->mTextureCoords[0][i].y);
-        }
+        float* vertex = &vertices[i * MESH_IMPORT_VERTEX_SIZE];
+        memcpy(&vertex[0], &mesh->mVertices[i], 3 * sizeof(float));
+        // Texture Coordinates, when the mesh has them
+        if (mesh->mTextureCoords[0])
+            memcpy(&vertex[3], &mesh->mTextureCoords[0][i], 2 * sizeof(float));
         else
-        {
-            position_texture_normal.push_back(0.0f);
-            position_texture_normal.push_back(0.0f);
-        }
-
-        position_texture_normal.push_back(mesh->mNormals[i].x);
-        position_texture_normal.push_back(mesh->mNormals[i].y);
-        position_texture_normal.push_back(mesh->mNormals[i].z);
+            vertex[3] = vertex[4] = 0.0f;
+        if (mesh->mNormals)
+            memcpy(&vertex[5], &mesh->mNormals[i], 3 * sizeof(float));
+        else
+            vertex[5] = vertex[6] = vertex[7] = 0.0f;
     }
 
-    std::vector<uint> indicies;
-
-    // Now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+    // faces are triangles after aiProcess_Triangulate, points and lines are skipped
+    std::vector<uint> indices(mesh->mNumFaces * 3);
+    uint indexCount = 0;
     for (uint i = 0; i < mesh->mNumFaces; i++)
     {
-        aiFace face = mesh->mFaces[i];
-        if (face.mNumIndices < 3) {
+        const aiFace& face = mesh->mFaces[i];
+        if (face.mNumIndices != 3)
             continue;
-        }
-        // Retrieve all indices of the face and store them in the indices vector
-        for (uint j = 0; j < face.mNumIndices; j++)
-        {
-            indicies.push_back(face.mIndices[j]);
-        }
+        memcpy(&indices[indexCount], face.mIndices, 3 * sizeof(uint));
+        indexCount += 3;
     }
+    indices.resize(indexCount);
+    if (indices.empty())
+        return;
 
-    m_VA = new VertexArray();
-    m_VBL = new VertexBufferLayout();
-    m_IB = new IndexBuffer(indicies.data(), indicies.size());
-    m_VB = new VertexBuffer(position_texture_normal.data(), position_texture_normal.size() * sizeof(float));
+    // OBJ faces come unwelded and in file order, done once here and kept in the cache
+    MeshOptimizeStats meshStats = OptimizeMesh(vertices, indices, MESH_IMPORT_VERTEX_SIZE);
+    stats.VerticesBefore += meshStats.VerticesBefore;
+    stats.VerticesAfter += meshStats.VerticesAfter;
+    stats.TrianglesBefore += meshStats.TrianglesBefore;
+    stats.TrianglesAfter += meshStats.TrianglesAfter;
+    // weighted by triangles, divided by LoadData
+    stats.ACMRBefore += meshStats.ACMRBefore * meshStats.TrianglesBefore;
+    stats.ACMRAfter += meshStats.ACMRAfter * meshStats.TrianglesAfter;
+    stats.OverdrawClusters += meshStats.OverdrawClusters;
+
+    std::vector<MeshLod> lods;
+    BuildLods(vertices, indices, lods);
 
-    // positions
-    m_VBL->Push<float>(3);
-    // texture
-    m_VBL->Push<float>(2);
-    // normals
-    m_VBL->Push<float>(3);
+    SubMesh subMesh = {};
+    subMesh.BaseVertex = data.ImportedVertices.size() / MESH_IMPORT_VERTEX_SIZE;
+    subMesh.VertexCount = vertices.size() / MESH_IMPORT_VERTEX_SIZE;
+    subMesh.Material = mesh->mMaterialIndex;
+    subMesh.LodCount = lods.size();
+    for (uint i = 0; i < lods.size(); i++)
+    {
+        subMesh.Lods[i] = lods[i];
+        subMesh.Lods[i].FirstIndex += data.ImportedIndices.size();
+    }
+    data.SubMeshes.push_back(subMesh);
 
+    data.ImportedVertices.insert(data.ImportedVertices.end(), vertices.begin(), vertices.end());
+    data.ImportedIndices.insert(data.ImportedIndices.end(), indices.begin(), indices.end());
+}
+
+void Mesh::CreateBuffers(const MeshData& data)
+{
+    m_VA = new VertexArray();
+    m_VBL = new VertexBufferLayout(data.Layout);
+    m_IB = new IndexBuffer(data.Indices, data.IndexCount, data.IndexType, GL_TRIANGLES);
+    m_VB = new VertexBuffer(data.Vertices, data.VertexCount * m_VBL->GetStride());
     m_VA->AddBuffer(*m_VB, *m_VBL);
+
+    m_BoundsMin = data.BoundsMin;
+    m_BoundsMax = data.BoundsMax;
+    m_BoundingCentre = data.BoundingCentre;
+    m_BoundingRadius = data.BoundingRadius;
+    m_Quantized = data.Quantized;
+    m_SubMeshes = data.SubMeshes;
+}
+
+void Mesh::BuildLods(const std::vector<float>& vertices, std::vector<uint>& indices, std::vector<MeshLod>& lods)
+{
+    lods.clear();
+    lods.push_back(MeshLod{ 0, (uint)indices.size(), 0.f });
+
+    // every level simplifies the one before, all of them index the same vertices
+    while (lods.size() < MESH_MAX_LODS)
+    {
+        const MeshLod& previous = lods.back();
+        std::vector<uint> source(indices.begin() + previous.FirstIndex, indices.begin() + previous.FirstIndex + previous.IndexCount);
+        uint target = (uint)(source.size() / 3 * MESH_LOD_REDUCTION) * 3;
+        float error = 0.f;
+        std::vector<uint> simplified = SimplifyMesh(source, vertices, MESH_IMPORT_VERTEX_SIZE, target, &error);
+        if (simplified.size() > source.size() * MESH_LOD_MIN_REDUCTION)
+            break;
+
+        simplified = OptimizeVertexCache(simplified, vertices.size() / MESH_IMPORT_VERTEX_SIZE);
+        // errors of the levels add up, each one is measured from the level before
+        lods.push_back(MeshLod{ (uint)indices.size(), (uint)simplified.size(), previous.Error + error });
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+    }
 }
 
-void Mesh::LoadMesh(const std::string& path)
+bool Mesh::LoadData(const std::string& path, MeshData& data)
 {
+    std::string cachePath = path + MESH_CACHE_EXTENSION;
+    unsigned long long sourceHash = HashFile(path);
+    if (LoadCache(cachePath, sourceHash, data))
+        return true;
+
     // Read file via ASSIMP
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
@@ -94,22 +280,203 @@ void Mesh::LoadMesh(const std::string& path)
     if (!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
     {
         std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-        return;
+        return false;
+    }
+
+    MeshOptimizeStats stats;
+    ProcessNode(scene->mRootNode, scene, data, stats);
+    if (stats.TrianglesBefore > 0)
+        stats.ACMRBefore /= stats.TrianglesBefore;
+    if (stats.TrianglesAfter > 0)
+        stats.ACMRAfter /= stats.TrianglesAfter;
+
+    const std::vector<float>& vertices = data.ImportedVertices;
+    data.VertexCount = vertices.size() / MESH_IMPORT_VERTEX_SIZE;
+    data.Indices = data.ImportedIndices.data();
+    data.IndexCount = data.ImportedIndices.size();
+    // submesh indices are relative to their base vertex, so they fit in 16 bits unless one part is that large;
+    // 0xFFFF stays free for the restart index
+    uint maxIndex = 0;
+    for (uint index : data.ImportedIndices)
+        maxIndex = std::max(maxIndex, index);
+    if (maxIndex < 0xFFFF)
+    {
+        data.ImportedShortIndices.assign(data.ImportedIndices.begin(), data.ImportedIndices.end());
+        data.Indices = data.ImportedShortIndices.data();
+        data.IndexType = GL_UNSIGNED_SHORT;
     }
 
-    ProcessNode(scene->mRootNode, scene);
+    if (data.VertexCount > 0)
+    {
+        data.BoundsMin = data.BoundsMax = glm::make_vec3(&vertices[0]);
+        for (uint i = 1; i < data.VertexCount; i++)
+        {
+            glm::vec3 position = glm::make_vec3(&vertices[i * MESH_IMPORT_VERTEX_SIZE]);
+            data.BoundsMin = glm::min(data.BoundsMin, position);
+            data.BoundsMax = glm::max(data.BoundsMax, position);
+        }
+
+        // around the centre of the box, tighter than its half diagonal for rounded shapes like the pieces
+        data.BoundingCentre = 0.5f * (data.BoundsMin + data.BoundsMax);
+        float radiusSquared = 0.f;
+        for (uint i = 0; i < data.VertexCount; i++)
+        {
+            glm::vec3 offset = glm::make_vec3(&vertices[i * MESH_IMPORT_VERTEX_SIZE]) - data.BoundingCentre;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+        data.BoundingRadius = sqrtf(radiusSquared);
+    }
+
+    data.Quantized = s_QuantizeImport;
+    PushImportLayout(data.Layout, data.Quantized);
+    if (data.Quantized)
+    {
+        QuantizeVertices(vertices, data.BoundsMin, data.BoundsMax, data.QuantizedVertices);
+        data.Vertices = data.QuantizedVertices.data();
+    }
+    else
+        data.Vertices = vertices.data();
+
+    std::cout << "Optimized " << path << ": submeshes " << data.SubMeshes.size() << ", vertices " << stats.VerticesBefore << " -> " << stats.VerticesAfter
+        << ", triangles " << stats.TrianglesBefore << " -> " << stats.TrianglesAfter
+        << ", ACMR " << stats.ACMRBefore << " -> " << stats.ACMRAfter
+        << ", overdraw clusters " << stats.OverdrawClusters
+        << ", vertex size " << MESH_IMPORT_VERTEX_SIZE * sizeof(float) << " -> " << data.Layout.GetStride() << " bytes";
+    uint lodCount = 0;
+    for (const SubMesh& subMesh : data.SubMeshes)
+        lodCount = std::max(lodCount, subMesh.LodCount);
+    std::cout << ", levels of detail " << lodCount << " (triangles";
+    for (uint level = 0; level < lodCount; level++)
+    {
+        uint triangles = 0;
+        for (const SubMesh& subMesh : data.SubMeshes)
+            triangles += subMesh.Lods[std::min(level, subMesh.LodCount - 1)].IndexCount / 3;
+        std::cout << " " << triangles;
+    }
+    std::cout << ")" << std::endl;
+    // nothing could be simplified, every distance draws the full mesh
+    if (lodCount <= 1)
+        std::cout << "No coarser levels of detail could be built for " << path << std::endl;
+
+    if (sourceHash != 0)
+        WriteCache(cachePath, sourceHash, data);
+    return true;
+}
+
+bool Mesh::LoadCache(const std::string& cachePath, unsigned long long sourceHash, MeshData& data)
+{
+    std::unique_ptr<MappedFile> file(new MappedFile(cachePath));
+    if (file->GetSize() < sizeof(MeshCacheHeader))
+        return false;
+
+    const MeshCacheHeader* header = (const MeshCacheHeader*)file->GetData();
+    if (memcmp(header->Magic, "MSHC", 4) != 0 || header->Version != MESH_CACHE_VERSION)
+        return false;
+    // no source to compare with (only the cache was installed) - the cache is used as it is
+    if (sourceHash != 0 && header->SourceHash != sourceHash)
+        return false;
+    // the shaders decode every mesh with the layout of s_QuantizeImport, a cache in the other one would draw garbage
+    if ((header->Quantized != 0) != s_QuantizeImport)
+    {
+        if (sourceHash == 0)
+            std::cout << "Mesh cache " << cachePath << " has " << (header->Quantized != 0 ? "quantized" : "float")
+                << " vertices and its source is missing, run " << (header->Quantized != 0 ? "without" : "with") << " --float-vertices" << std::endl;
+        return false;
+    }
+    if (header->AttributeCount > MESH_CACHE_MAX_ATTRIBUTES)
+        return false;
+
+    VertexBufferLayout layout;
+    for (uint i = 0; i < header->AttributeCount; i++)
+        layout.PushElement(VertexElement{ header->Attributes[i].Type, header->Attributes[i].Count, (uchar)header->Attributes[i].Normalized });
+    // truncated or foreign file
+    size_t subMeshBytes = (size_t)header->SubMeshCount * sizeof(SubMesh);
+    size_t vertexBytes = (size_t)header->VertexCount * layout.GetStride();
+    if (header->IndexType != GL_UNSIGNED_SHORT && header->IndexType != GL_UNSIGNED_INT)
+        return false;
+    if (file->GetSize() != sizeof(MeshCacheHeader) + subMeshBytes + vertexBytes + (size_t)header->IndexCount * IndexBuffer::GetTypeSize(header->IndexType))
+        return false;
+
+    const SubMesh* subMeshes = (const SubMesh*)(file->GetData() + sizeof(MeshCacheHeader));
+    data.SubMeshes.assign(subMeshes, subMeshes + header->SubMeshCount);
+    for (const SubMesh& subMesh : data.SubMeshes)
+    {
+        if (subMesh.LodCount == 0 || subMesh.LodCount > MESH_MAX_LODS || (size_t)subMesh.BaseVertex + subMesh.VertexCount > header->VertexCount)
+            return false;
+        for (uint i = 0; i < subMesh.LodCount; i++)
+            if ((size_t)subMesh.Lods[i].FirstIndex + subMesh.Lods[i].IndexCount > header->IndexCount)
+                return false;
+    }
+
+    // mapped pages go straight to the buffers, nothing is parsed or copied on the CPU side
+    data.Vertices = file->GetData() + sizeof(MeshCacheHeader) + subMeshBytes;
+    data.VertexCount = header->VertexCount;
+    data.Indices = file->GetData() + sizeof(MeshCacheHeader) + subMeshBytes + vertexBytes;
+    data.IndexCount = header->IndexCount;
+    data.IndexType = header->IndexType;
+    data.Layout = layout;
+    data.Quantized = header->Quantized != 0;
+    data.BoundsMin = glm::make_vec3(header->BoundsMin);
+    data.BoundsMax = glm::make_vec3(header->BoundsMax);
+    data.BoundingCentre = glm::make_vec3(header->BoundingCentre);
+    data.BoundingRadius = header->BoundingRadius;
+    data.Cache = std::move(file);
+    return true;
+}
+
+void Mesh::WriteCache(const std::string& cachePath, unsigned long long sourceHash, const MeshData& data)
+{
+    MeshCacheHeader header = {};
+    memcpy(header.Magic, "MSHC", 4);
+    header.Version = MESH_CACHE_VERSION;
+    header.SourceHash = sourceHash;
+    header.VertexCount = data.VertexCount;
+    header.IndexCount = data.IndexCount;
+    header.IndexType = data.IndexType;
+    const std::vector<VertexElement>& elements = data.Layout.GetElements();
+    header.AttributeCount = elements.size();
+    for (uint i = 0; i < elements.size(); i++)
+        header.Attributes[i] = MeshCacheAttribute{ elements[i].type, elements[i].count, elements[i].normalized };
+    header.Quantized = data.Quantized;
+    header.SubMeshCount = data.SubMeshes.size();
+    for (int i = 0; i < 3; i++)
+    {
+        header.BoundsMin[i] = data.BoundsMin[i];
+        header.BoundsMax[i] = data.BoundsMax[i];
+        header.BoundingCentre[i] = data.BoundingCentre[i];
+    }
+    header.BoundingRadius = data.BoundingRadius;
+
+    // a partly written cache fails the size check and is imported again next time
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)data.SubMeshes.data(), data.SubMeshes.size() * sizeof(SubMesh));
+    file.write((const char*)data.Vertices, (size_t)data.VertexCount * data.Layout.GetStride());
+    file.write((const char*)data.Indices, (size_t)data.IndexCount * IndexBuffer::GetTypeSize(data.IndexType));
+    if (!file)
+        std::cout << "Mesh cache " << cachePath << " couldn't be written" << std::endl;
 }
 
 
 Mesh::Mesh(const std::string& path)
 {
-	LoadMesh(path);
+    MeshData data;
+    if (LoadData(path, data))
+        CreateBuffers(data);
+}
+
+Mesh::Mesh(const MeshData& data)
+{
+    CreateBuffers(data);
 }
 
 Mesh::~Mesh()
 {
-    UnBind();
+    // nothing was created when the import failed
+    if (m_VA != nullptr)
+        UnBind();
     delete m_VB;
+    delete m_InstanceVB;
     delete m_VBL;
     delete m_IB;
     delete m_VA;
@@ -126,3 +493,121 @@ void Mesh::UnBind() const
     m_VA->UnBind();
     m_IB->UnBind();
 }
+
+uint Mesh::GetId() const
+{
+    return m_VA->GetId();
+}
+
+void Mesh::SetBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    m_BoundsMin = boundsMin;
+    m_BoundsMax = boundsMax;
+    m_BoundingCentre = 0.5f * (boundsMin + boundsMax);
+    m_BoundingRadius = 0.5f * glm::length(boundsMax - boundsMin);
+}
+
+void Mesh::SetDecodeUniforms(Shader& shader) const
+{
+    if (!m_Quantized)
+        return;
+    shader.SetUniform3f("u_PositionOffset", m_BoundsMin);
+    shader.SetUniform3f("u_PositionScale", m_BoundsMax - m_BoundsMin);
+}
+
+void Mesh::Draw() const
+{
+    DrawLod(0);
+}
+
+uint Mesh::GetLodCount() const
+{
+    uint levels = 1;
+    for (const SubMesh& subMesh : m_SubMeshes)
+        levels = std::max(levels, subMesh.LodCount);
+    return levels;
+}
+
+float Mesh::GetLodError(uint level) const
+{
+    float error = 0.f;
+    for (const SubMesh& subMesh : m_SubMeshes)
+        error = std::max(error, subMesh.Lods[std::min(level, subMesh.LodCount - 1)].Error);
+    return error;
+}
+
+void Mesh::DrawLod(uint level) const
+{
+    DrawElements(level, 0);
+}
+
+void Mesh::DrawInstanced(uint level, const MeshInstance* instances, uint count) const
+{
+    if (count == 0)
+        return;
+
+    uint size = count * sizeof(MeshInstance);
+    if (m_InstanceVB == nullptr)
+    {
+        m_InstanceVB = new VertexBuffer(nullptr, size, GL_STREAM_DRAW);
+        // model matrix takes one attribute per column
+        VertexBufferLayout layout;
+        for (int i = 0; i < 4; i++)
+            layout.Push<float>(4);
+        layout.Push<float>(4);
+        m_VA->AddBuffer(*m_InstanceVB, layout, 1);
+    }
+    else if (size > m_InstanceVB->GetSize())
+    {
+        m_InstanceVB->Reserve(std::max(size, 2 * m_InstanceVB->GetSize()));
+    }
+    m_InstanceVB->Update(instances, size);
+
+    DrawElements(level, count);
+}
+
+void Mesh::DrawElements(uint level, uint instanceCount) const
+{
+    // strips in one buffer are separated by the restart index
+    bool strips = m_IB->GetMode() == GL_TRIANGLE_STRIP;
+    if (strips)
+    {
+        Renderer::SetEnabled(GL_PRIMITIVE_RESTART, true);
+        GLCall(glPrimitiveRestartIndex(m_IB->GetRestartIndex()));
+    }
+
+    if (m_SubMeshes.empty())
+    {
+        s_DrawnIndices += GetIndexCount() * std::max(instanceCount, 1u);
+        if (instanceCount == 0)
+        {
+            GLCall(glDrawElements(m_IB->GetMode(), GetIndexCount(), m_IB->GetType(), 0));
+        }
+        else
+        {
+            GLCall(glDrawElementsInstanced(m_IB->GetMode(), GetIndexCount(), m_IB->GetType(), 0, instanceCount));
+        }
+    }
+
+    // all parts from the one bound vertex array, indices of each are relative to its first vertex
+    uint indexSize = m_IB->GetType() == GL_UNSIGNED_SHORT ? sizeof(ushort) : sizeof(uint);
+    for (const SubMesh& subMesh : m_SubMeshes)
+    {
+        const MeshLod& lod = subMesh.Lods[std::min(level, subMesh.LodCount - 1)];
+        void* offset = (void*)(size_t)(lod.FirstIndex * indexSize);
+        s_DrawnIndices += lod.IndexCount * std::max(instanceCount, 1u);
+        if (instanceCount == 0)
+        {
+            GLCall(glDrawElementsBaseVertex(m_IB->GetMode(), lod.IndexCount, m_IB->GetType(), offset, subMesh.BaseVertex));
+        }
+        else
+        {
+            GLCall(glDrawElementsInstancedBaseVertex(m_IB->GetMode(), lod.IndexCount, m_IB->GetType(), offset, instanceCount, subMesh.BaseVertex));
+        }
+    }
+
+    if (strips)
+    {
+        Renderer::SetEnabled(GL_PRIMITIVE_RESTART, false);
+    }
+}
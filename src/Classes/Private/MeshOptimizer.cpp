@@ -0,0 +1,630 @@
+#include "../Public/MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+float CalculateACMR(const std::vector<uint>& indices, uint mode, uint cacheSize)
+{
+	std::vector<uint> cache;
+	uint transforms = 0;
+	uint triangles = 0;
+	// indices of the current strip
+	uint stripLength = 0;
+
+	for (uint index : indices)
+	{
+		if (index == INDEX_RESTART)
+		{
+			stripLength = 0;
+			continue;
+		}
+
+		if (std::find(cache.begin(), cache.end(), index) == cache.end())
+		{
+			transforms++;
+			cache.push_back(index);
+			if (cache.size() > cacheSize)
+				cache.erase(cache.begin());
+		}
+
+		stripLength++;
+		if (mode == GL_TRIANGLE_STRIP && stripLength >= 3)
+			triangles++;
+	}
+
+	if (mode != GL_TRIANGLE_STRIP)
+		triangles = indices.size() / 3;
+	return triangles > 0 ? (float)transforms / triangles : 0.f;
+}
+
+std::vector<uint> BuildGridIndices(int rows, int columns, bool strips, int band)
+{
+	std::vector<uint> indices;
+	for (int first = 0; first < rows - 1; first += band)
+	{
+		int last = std::min(first + band, rows - 1);
+		for (int j = 0; j < columns - 1; j++)
+		{
+			if (strips)
+			{
+				// (i, j), (i, j + 1) pairs down the column, same winding as the list below
+				if (!indices.empty())
+					indices.push_back(INDEX_RESTART);
+				for (int i = first; i <= last; i++)
+				{
+					indices.push_back(i * columns + j);
+					indices.push_back(i * columns + j + 1);
+				}
+				continue;
+			}
+
+			for (int i = first; i < last; i++)
+			{
+				indices.push_back(i * columns + j); //tl
+				indices.push_back(i * columns + j + 1); //tr
+				indices.push_back((i + 1) * columns + j); //bl
+				indices.push_back(i * columns + j + 1); //tr
+				indices.push_back((i + 1) * columns + j + 1); //br
+				indices.push_back((i + 1) * columns + j); //bl
+			}
+		}
+	}
+	return indices;
+}
+
+void WeldVertices(std::vector<float>& vertices, std::vector<uint>& indices, uint vertexSize)
+{
+	uint vertexCount = vertices.size() / vertexSize;
+	size_t vertexBytes = vertexSize * sizeof(float);
+
+	// equal vertices end up next to each other, bitwise compare keeps the order strict
+	std::vector<uint> sorted(vertexCount);
+	for (uint i = 0; i < vertexCount; i++)
+		sorted[i] = i;
+	std::sort(sorted.begin(), sorted.end(), [&](uint a, uint b)
+	{
+		int order = memcmp(&vertices[a * vertexSize], &vertices[b * vertexSize], vertexBytes);
+		return order != 0 ? order < 0 : a < b;
+	});
+
+	// every vertex maps to the first of its equals, which keeps its place for now
+	std::vector<uint> remap(vertexCount);
+	for (uint i = 0; i < vertexCount; i++)
+	{
+		bool same = i > 0 && memcmp(&vertices[sorted[i] * vertexSize], &vertices[sorted[i - 1] * vertexSize], vertexBytes) == 0;
+		remap[sorted[i]] = same ? remap[sorted[i - 1]] : sorted[i];
+	}
+
+	std::vector<uint> welded;
+	welded.reserve(indices.size());
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		uint a = remap[indices[t]];
+		uint b = remap[indices[t + 1]];
+		uint c = remap[indices[t + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+		welded.push_back(a);
+		welded.push_back(b);
+		welded.push_back(c);
+	}
+	indices.swap(welded);
+
+	// drops the merged copies
+	OptimizeVertexFetch(vertices, indices, vertexSize);
+}
+
+std::vector<uint> OptimizeVertexCache(const std::vector<uint>& indices, uint vertexCount, uint cacheSize, std::vector<uint>* clusters)
+{
+	uint triangleCount = indices.size() / 3;
+
+	// triangles of every vertex: adjacency[offsets[v] .. offsets[v + 1])
+	std::vector<uint> offsets(vertexCount + 1, 0);
+	for (uint index : indices)
+		offsets[index + 1]++;
+	for (uint v = 0; v < vertexCount; v++)
+		offsets[v + 1] += offsets[v];
+	std::vector<uint> adjacency(indices.size());
+	std::vector<uint> filled(offsets.begin(), offsets.end() - 1);
+	for (uint i = 0; i < indices.size(); i++)
+		adjacency[filled[indices[i]]++] = i / 3;
+
+	// triangles not emitted yet per vertex
+	std::vector<uint> live(vertexCount);
+	for (uint v = 0; v < vertexCount; v++)
+		live[v] = offsets[v + 1] - offsets[v];
+
+	std::vector<uint> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint> deadEnd;
+	std::vector<uint> candidates;
+	std::vector<uint> result;
+	result.reserve(indices.size());
+	if (clusters)
+		clusters->clear();
+
+	uint time = cacheSize + 1;
+	uint cursor = 0;
+	int fan = triangleCount > 0 ? (int)indices[0] : -1;
+	// the first fan starts with an empty cache
+	bool cold = true;
+
+	while (fan >= 0)
+	{
+		if (cold && clusters)
+			clusters->push_back(result.size() / 3);
+
+		candidates.clear();
+		for (uint a = offsets[fan]; a < offsets[fan + 1]; a++)
+		{
+			uint t = adjacency[a];
+			if (emitted[t])
+				continue;
+			emitted[t] = true;
+
+			for (uint k = 0; k < 3; k++)
+			{
+				uint v = indices[t * 3 + k];
+				result.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				// cache miss, the vertex enters the FIFO
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+		}
+
+		// next fan: the candidate staying in the cache the longest that can still be finished before it's evicted
+		fan = -1;
+		int priority = -1;
+		for (uint v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+			int p = 0;
+			if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+				p = time - cacheTime[v];
+			if (p > priority)
+			{
+				priority = p;
+				fan = v;
+			}
+		}
+		cold = false;
+		if (fan >= 0)
+			continue;
+
+		// dead end: a recently used vertex with triangles left, then the first one in index order
+		while (!deadEnd.empty() && fan < 0)
+		{
+			uint v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0)
+				fan = v;
+		}
+		if (fan < 0)
+		{
+			while (cursor < vertexCount && live[cursor] == 0)
+				cursor++;
+			fan = cursor < vertexCount ? (int)cursor : -1;
+		}
+		cold = fan >= 0 && time - cacheTime[fan] > cacheSize;
+	}
+	return result;
+}
+
+bool OptimizeOverdraw(std::vector<uint>& indices, const std::vector<uint>& clusters, const std::vector<float>& vertices, uint vertexSize, float threshold)
+{
+	if (clusters.size() < 2)
+		return false;
+
+	auto position = [&](uint index) { return glm::make_vec3(&vertices[index * vertexSize]); };
+
+	// area weighted centre of the whole mesh
+	glm::vec3 meshCentre(0.f);
+	float meshArea = 0.f;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		glm::vec3 a = position(indices[t]), b = position(indices[t + 1]), c = position(indices[t + 2]);
+		float area = glm::length(glm::cross(b - a, c - a));
+		meshCentre += area * (a + b + c) / 3.f;
+		meshArea += area;
+	}
+	if (meshArea > 0.f)
+		meshCentre /= meshArea;
+
+	// clusters facing outwards (centre ahead of the mesh centre along their normal) first
+	uint triangleCount = indices.size() / 3;
+	std::vector<float> keys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		uint last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		glm::vec3 centre(0.f);
+		glm::vec3 normal(0.f);
+		float area = 0.f;
+		for (uint t = clusters[c]; t < last; t++)
+		{
+			glm::vec3 p0 = position(indices[t * 3]), p1 = position(indices[t * 3 + 1]), p2 = position(indices[t * 3 + 2]);
+			glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(cross);
+			centre += triangleArea * (p0 + p1 + p2) / 3.f;
+			normal += cross;
+			area += triangleArea;
+		}
+		if (area > 0.f)
+			centre /= area;
+		float length = glm::length(normal);
+		keys[c] = length > 0.f ? glm::dot(centre - meshCentre, normal / length) : 0.f;
+	}
+
+	std::vector<uint> order(clusters.size());
+	for (uint c = 0; c < order.size(); c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](uint a, uint b) { return keys[a] > keys[b]; });
+
+	std::vector<uint> sorted;
+	sorted.reserve(indices.size());
+	for (uint c : order)
+	{
+		uint last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		sorted.insert(sorted.end(), indices.begin() + clusters[c] * 3, indices.begin() + last * 3);
+	}
+
+	if (CalculateACMR(sorted, GL_TRIANGLES) > threshold * CalculateACMR(indices, GL_TRIANGLES))
+		return false;
+	indices.swap(sorted);
+	return true;
+}
+
+void OptimizeVertexFetch(std::vector<float>& vertices, std::vector<uint>& indices, uint vertexSize)
+{
+	uint vertexCount = vertices.size() / vertexSize;
+	std::vector<uint> remap(vertexCount, INDEX_RESTART);
+	std::vector<float> fetched;
+	fetched.reserve(vertices.size());
+
+	for (uint& index : indices)
+	{
+		if (remap[index] == INDEX_RESTART)
+		{
+			remap[index] = fetched.size() / vertexSize;
+			fetched.insert(fetched.end(), vertices.begin() + index * vertexSize, vertices.begin() + (index + 1) * vertexSize);
+		}
+		index = remap[index];
+	}
+	vertices.swap(fetched);
+}
+
+MeshOptimizeStats OptimizeMesh(std::vector<float>& vertices, std::vector<uint>& indices, uint vertexSize)
+{
+	MeshOptimizeStats stats;
+	stats.VerticesBefore = vertices.size() / vertexSize;
+	stats.TrianglesBefore = indices.size() / 3;
+	stats.ACMRBefore = CalculateACMR(indices, GL_TRIANGLES);
+
+	WeldVertices(vertices, indices, vertexSize);
+	std::vector<uint> clusters;
+	indices = OptimizeVertexCache(indices, vertices.size() / vertexSize, MESH_VERTEX_CACHE_SIZE, &clusters);
+	if (OptimizeOverdraw(indices, clusters, vertices, vertexSize))
+		stats.OverdrawClusters = clusters.size();
+	OptimizeVertexFetch(vertices, indices, vertexSize);
+
+	stats.VerticesAfter = vertices.size() / vertexSize;
+	stats.TrianglesAfter = indices.size() / 3;
+	stats.ACMRAfter = CalculateACMR(indices, GL_TRIANGLES);
+	return stats;
+}
+
+// sum of squared distances to a set of planes, symmetric 4x4 matrix in 10 values
+struct Quadric
+{
+	double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+	void AddPlane(glm::dvec3 n, double d)
+	{
+		a2 += n.x * n.x; ab += n.x * n.y; ac += n.x * n.z; ad += n.x * d;
+		b2 += n.y * n.y; bc += n.y * n.z; bd += n.y * d;
+		c2 += n.z * n.z; cd += n.z * d;
+		d2 += d * d;
+	}
+
+	void Add(const Quadric& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+	}
+
+	double Error(glm::dvec3 p) const
+	{
+		double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+			+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+			+ c2 * p.z * p.z + 2 * cd * p.z + d2;
+		return std::max(e, 0.0);
+	}
+};
+
+// distance from p to the closest point of triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+static double PointTriangleDistance(glm::dvec3 p, glm::dvec3 a, glm::dvec3 b, glm::dvec3 c)
+{
+	glm::dvec3 ab = b - a, ac = c - a, ap = p - a;
+	double d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0 && d2 <= 0.0)
+		return glm::length(ap);
+	glm::dvec3 bp = p - b;
+	double d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0 && d4 <= d3)
+		return glm::length(bp);
+	double vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+		return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+	glm::dvec3 cp = p - c;
+	double d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0 && d5 <= d6)
+		return glm::length(cp);
+	double vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+		return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+	double va = d3 * d6 - d5 * d4;
+	if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+		return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+	double denominator = 1.0 / (va + vb + vc);
+	return glm::length(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+}
+
+std::vector<uint> SimplifyMesh(const std::vector<uint>& indices, const std::vector<float>& vertices, uint vertexSize, uint targetIndexCount, float* error)
+{
+	uint vertexCount = vertices.size() / vertexSize;
+	auto position = [&](uint v) { return glm::dvec3(glm::make_vec3(&vertices[v * vertexSize])); };
+	// squared difference of everything but the position
+	auto attributeDistance = [&](uint a, uint b)
+	{
+		float distance = 0.f;
+		for (uint k = 3; k < vertexSize; k++)
+			distance += (vertices[a * vertexSize + k] - vertices[b * vertexSize + k]) * (vertices[a * vertexSize + k] - vertices[b * vertexSize + k]);
+		return distance;
+	};
+
+	// vertices at the same position (copies along texture or normal seams) form a group named by its first vertex,
+	// its members are sorted[groupFirst[group] ..] and the group collapses as a whole, so seams stay closed
+	std::vector<uint> sorted(vertexCount);
+	for (uint i = 0; i < vertexCount; i++)
+		sorted[i] = i;
+	std::sort(sorted.begin(), sorted.end(), [&](uint a, uint b)
+	{
+		int order = memcmp(&vertices[a * vertexSize], &vertices[b * vertexSize], 3 * sizeof(float));
+		return order != 0 ? order < 0 : a < b;
+	});
+	std::vector<uint> group(vertexCount);
+	std::vector<uint> groupFirst(vertexCount, 0);
+	std::vector<uint> groupSize(vertexCount, 0);
+	for (uint i = 0; i < vertexCount; i++)
+	{
+		bool same = i > 0 && memcmp(&vertices[sorted[i] * vertexSize], &vertices[sorted[i - 1] * vertexSize], 3 * sizeof(float)) == 0;
+		group[sorted[i]] = same ? group[sorted[i - 1]] : sorted[i];
+		if (!same)
+			groupFirst[sorted[i]] = i;
+		groupSize[group[sorted[i]]]++;
+	}
+
+	// border edges have no twin running the other way, groups on them stay in place
+	std::vector<bool> locked(vertexCount, false);
+	std::vector<std::pair<uint, uint>> edges;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		for (int k = 0; k < 3; k++)
+			edges.push_back(std::make_pair(group[indices[t + k]], group[indices[t + (k + 1) % 3]]));
+	std::vector<std::pair<uint, uint>> sortedEdges(edges);
+	std::sort(sortedEdges.begin(), sortedEdges.end());
+	for (const std::pair<uint, uint>& edge : edges)
+	{
+		if (!std::binary_search(sortedEdges.begin(), sortedEdges.end(), std::make_pair(edge.second, edge.first)))
+			locked[edge.first] = locked[edge.second] = true;
+	}
+
+	// by group
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		glm::dvec3 p0 = position(indices[t]), p1 = position(indices[t + 1]), p2 = position(indices[t + 2]);
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double length = glm::length(normal);
+		if (length == 0.0)
+			continue;
+		normal /= length;
+		Quadric plane;
+		plane.AddPlane(normal, -glm::dot(normal, p0));
+		for (int k = 0; k < 3; k++)
+			quadrics[group[indices[t + k]]].Add(plane);
+	}
+
+	std::vector<uint> result(indices);
+	// vertex every source vertex has been moved onto
+	std::vector<uint> merged(vertexCount);
+	for (uint v = 0; v < vertexCount; v++)
+		merged[v] = v;
+
+	struct Collapse
+	{
+		uint From;
+		uint To;
+		double Error;
+	};
+	std::vector<Collapse> collapses;
+	std::vector<std::pair<uint, uint>> moves;
+	std::vector<uint> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint> offsets(vertexCount + 1);
+	std::vector<uint> adjacency;
+	// triangles of result around every vertex, adjacency[offsets[v] .. offsets[v + 1]]
+	auto buildAdjacency = [&]()
+	{
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (uint index : result)
+			offsets[index + 1]++;
+		for (uint v = 0; v < vertexCount; v++)
+			offsets[v + 1] += offsets[v];
+		adjacency.resize(result.size());
+		std::vector<uint> filled(offsets.begin(), offsets.end() - 1);
+		for (uint i = 0; i < result.size(); i++)
+			adjacency[filled[result[i]]++] = i / 3;
+	};
+
+	while (result.size() > targetIndexCount)
+	{
+		buildAdjacency();
+
+		// collapses of groups, From onto To
+		collapses.clear();
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint from = group[result[t + k]];
+				uint to = group[result[t + (k + 1) % 3]];
+				if (locked[from])
+					continue;
+				Quadric q = quadrics[from];
+				q.Add(quadrics[to]);
+				collapses.push_back(Collapse{ from, to, q.Error(position(to)) });
+				// other direction comes from the neighbour triangle sharing the edge
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+		for (uint v = 0; v < vertexCount; v++)
+			remap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		// cheapest collapses first, none of them changes a triangle another one changes; every collapse removes about two triangles
+		size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+		size_t collapsed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapsed * 2 >= trianglesToRemove)
+				break;
+			if (touched[collapse.From] || touched[collapse.To])
+				continue;
+
+			// every used copy of From moves onto the copy of To it shares an edge with (along a seam both sides do),
+			// otherwise onto the one with the closest attributes (flat shading, a normal of the neighbour facet)
+			moves.clear();
+			bool valid = true;
+			for (uint s = groupFirst[collapse.From]; s < groupFirst[collapse.From] + groupSize[collapse.From] && valid; s++)
+			{
+				uint copy = sorted[s];
+				if (offsets[copy] == offsets[copy + 1])
+					continue;
+				uint target = INDEX_RESTART;
+				for (uint a = offsets[copy]; a < offsets[copy + 1] && target == INDEX_RESTART; a++)
+					for (int k = 0; k < 3; k++)
+						if (group[result[adjacency[a] * 3 + k]] == collapse.To)
+							target = result[adjacency[a] * 3 + k];
+				float closest = MESH_SIMPLIFY_MAX_ATTRIBUTE_DISTANCE * MESH_SIMPLIFY_MAX_ATTRIBUTE_DISTANCE;
+				if (target == INDEX_RESTART)
+				{
+					for (uint s2 = groupFirst[collapse.To]; s2 < groupFirst[collapse.To] + groupSize[collapse.To]; s2++)
+					{
+						float distance = attributeDistance(copy, sorted[s2]);
+						if (distance <= closest)
+						{
+							closest = distance;
+							target = sorted[s2];
+						}
+					}
+				}
+				// e.g. the other side of a texture seam the edge doesn't run along, it would smear the texture
+				valid = target != INDEX_RESTART;
+				moves.push_back(std::make_pair(copy, target));
+			}
+			if (!valid || moves.empty())
+				continue;
+
+			// triangles keeping a moved vertex must not flip or get degenerate
+			glm::dvec3 destination = position(collapse.To);
+			bool flips = false;
+			for (const std::pair<uint, uint>& move : moves)
+			{
+				for (uint a = offsets[move.first]; a < offsets[move.first + 1] && !flips; a++)
+				{
+					const uint* triangle = &result[adjacency[a] * 3];
+					if (group[triangle[0]] == collapse.To || group[triangle[1]] == collapse.To || group[triangle[2]] == collapse.To)
+						continue;
+					glm::dvec3 p[3], q[3];
+					for (int k = 0; k < 3; k++)
+					{
+						p[k] = position(triangle[k]);
+						q[k] = triangle[k] == move.first ? destination : p[k];
+					}
+					glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+					glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+					double lengths = glm::length(before) * glm::length(after);
+					flips = lengths == 0.0 || glm::dot(before, after) < 0.25 * lengths;
+				}
+			}
+			if (flips)
+				continue;
+
+			for (const std::pair<uint, uint>& move : moves)
+			{
+				remap[move.first] = move.second;
+				for (uint a = offsets[move.first]; a < offsets[move.first + 1]; a++)
+					for (int k = 0; k < 3; k++)
+						touched[group[result[adjacency[a] * 3 + k]]] = true;
+			}
+			quadrics[collapse.To].Add(quadrics[collapse.From]);
+			collapsed++;
+		}
+		if (collapsed == 0)
+			break;
+
+		for (uint v = 0; v < vertexCount; v++)
+			merged[v] = remap[merged[v]];
+
+		std::vector<uint> next;
+		next.reserve(result.size());
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			uint a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+			// also gone when two corners are copies of one position
+			if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c])
+				continue;
+			next.push_back(a);
+			next.push_back(b);
+			next.push_back(c);
+		}
+		result.swap(next);
+	}
+
+	if (error)
+	{
+		// every source vertex against the result's triangles around the group it was merged into, at least its distance
+		// from the result, exact for the usual case of the nearest triangle being one of them
+		buildAdjacency();
+		double maxError = 0.0;
+		std::vector<bool> measured(vertexCount, false);
+		for (uint index : indices)
+		{
+			if (measured[index])
+				continue;
+			measured[index] = true;
+			uint to = group[merged[index]];
+			if (to == group[index])
+				continue;
+
+			glm::dvec3 p = position(index);
+			double distance = -1.0;
+			for (uint s = groupFirst[to]; s < groupFirst[to] + groupSize[to]; s++)
+			{
+				for (uint a = offsets[sorted[s]]; a < offsets[sorted[s] + 1]; a++)
+				{
+					const uint* triangle = &result[adjacency[a] * 3];
+					double d = PointTriangleDistance(p, position(triangle[0]), position(triangle[1]), position(triangle[2]));
+					distance = distance < 0.0 ? d : std::min(distance, d);
+				}
+			}
+			maxError = std::max(maxError, distance);
+		}
+		*error = (float)maxError;
+	}
+	return result;
+}
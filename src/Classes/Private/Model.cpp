@@ -1,11 +1,12 @@
 #include "../Public/Model.h"
+#include "../Public/Camera.h"
 #include <glm/gtc/type_ptr.hpp>
 
 
 std::map<int, std::shared_ptr<Mesh>> Model::meshMap = {};
 
 Model::Model(std::shared_ptr<Mesh> Mesh, std::shared_ptr<Texture> Tex, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale) :
-	m_Mesh(Mesh), m_Texture(Tex), m_Position(position), m_Rotation(rotation), m_Scale(scale)
+	m_Mesh(Mesh), m_Texture(Tex), m_Position(position), m_Rotation(rotation), m_Scale(scale), m_Up(0.f, 1.f, 0.f)
 {
 }
 
@@ -26,11 +27,107 @@ void Model::UnBind() const
 		m_Texture->UnBind();
 }
 
+void Model::SetUniforms(Shader& shader, bool modelMatrix) const
+{
+	if (modelMatrix)
+		shader.SetUniformMatrix4fv("u_Model", glm::value_ptr(GetModelMatrix()));
+	m_Mesh->SetDecodeUniforms(shader);
+
+	if (m_Texture != nullptr)
+		shader.SetUniform1i("u_Texture", 0);
+}
+
 void Model::Draw(Shader& shader) const
+{
+	Draw(shader, m_Lod);
+}
+
+void Model::Draw(Shader& shader, uint& lod) const
+{
+	lod = SelectLod(lod);
+
+	Bind();
+	shader.Bind();
+
+	SetUniforms(shader, true);
+
+	if (m_Mesh->GetLodCount() > 1)
+		m_Mesh->DrawLod(lod);
+	else
+		m_Mesh->Draw();
+}
+
+void Model::DrawInstanced(Shader& shader, uint lod, const std::vector<MeshInstance>& instances) const
 {
 	Bind();
 	shader.Bind();
 
+	SetUniforms(shader, false);
+
+	m_Mesh->DrawInstanced(std::min(lod, m_Mesh->GetLodCount() - 1), instances.data(), instances.size());
+}
+
+uint Model::SelectLod(uint current) const
+{
+	return SelectLod(current, GetModelMatrix());
+}
+
+uint Model::SelectLod(uint current, const glm::mat4& modelMatrix) const
+{
+	std::shared_ptr<Camera> camera = Camera::m_CurrCam;
+	uint levels = m_Mesh->GetLodCount();
+	if (levels <= 1 || camera == nullptr)
+		return 0;
+
+	// nearest point of the bounding sphere, the closest the model gets to the camera
+	float scale = std::max(m_Scale.x, std::max(m_Scale.y, m_Scale.z));
+	glm::vec3 centre = glm::vec3(modelMatrix * glm::vec4(0.5f * (m_Mesh->GetBoundsMin() + m_Mesh->GetBoundsMax()), 1.f));
+	float radius = 0.5f * glm::length(m_Mesh->GetBoundsMax() - m_Mesh->GetBoundsMin()) * scale;
+	float distance = std::max(glm::length(centre - camera->GetPosition()) - radius, 1e-3f);
+	float pixelsPerUnit = scale * camera->GetWindowHeight() / (2.f * tanf(0.5f * camera->GetFOVdeg()) * distance);
+
+	// errors grow with the level
+	uint level = 0;
+	for (uint l = 1; l < levels; l++)
+	{
+		float limit = l > current ? MODEL_LOD_PIXEL_ERROR * MODEL_LOD_HYSTERESIS : MODEL_LOD_PIXEL_ERROR;
+		if (m_Mesh->GetLodError(l) * pixelsPerUnit <= limit)
+			level = l;
+	}
+	return level;
+}
+
+bool Model::IsVisible(const Frustum& frustum) const
+{
+	return IsVisible(frustum, GetModelMatrix());
+}
+
+bool Model::IsVisible(const Frustum& frustum, const glm::mat4& modelMatrix) const
+{
+	if (!m_Mesh->HasBounds())
+		return true;
+
+	// longest axis of the matrix, the sphere grows with the largest scale
+	glm::mat3 axes(modelMatrix);
+	float scale = std::max(glm::length(axes[0]), std::max(glm::length(axes[1]), glm::length(axes[2])));
+	glm::vec3 centre = glm::vec3(modelMatrix * glm::vec4(m_Mesh->GetBoundingCentre(), 1.f));
+	if (!frustum.IntersectsSphere(centre, m_Mesh->GetBoundingRadius() * scale))
+		return false;
+
+	// world box around the rotated mesh box: every world extent sums the absolute contributions of the mesh axes
+	glm::vec3 boxCentre = glm::vec3(modelMatrix * glm::vec4(0.5f * (m_Mesh->GetBoundsMin() + m_Mesh->GetBoundsMax()), 1.f));
+	glm::vec3 halfExtent = 0.5f * (m_Mesh->GetBoundsMax() - m_Mesh->GetBoundsMin());
+	glm::vec3 extent = glm::abs(axes[0]) * halfExtent.x + glm::abs(axes[1]) * halfExtent.y + glm::abs(axes[2]) * halfExtent.z;
+	return frustum.IntersectsBox(boxCentre, extent);
+}
+
+glm::mat4 Model::GetModelMatrix() const
+{
+	return GetModelMatrix(m_Position, m_Up);
+}
+
+glm::mat4 Model::GetModelMatrix(glm::vec3 position, glm::vec3 up) const
+{
 	glm::mat4 model(1.0f);
 	model = glm::scale(model, m_Scale);
 
@@ -38,18 +135,14 @@ void Model::Draw(Shader& shader) const
 	model = glm::rotate(model, glm::radians(m_Rotation.y), glm::vec3(0.f, 1.f, 0.f));
 	model = glm::rotate(model, glm::radians(m_Rotation.z), glm::vec3(0.f, 1.f, 0.f));
 
-	//model = glm::translate(model, m_Position);
-	auto translate = glm::translate(glm::mat4(1.f), m_Position);
-
-	shader.SetUniformMatrix4fv("u_Model", glm::value_ptr(translate * model));
+	// tilt from upright to up
+	glm::vec3 axis = glm::cross(glm::vec3(0.f, 1.f, 0.f), up);
+	if (glm::length(axis) > 1e-6f)
+		model = glm::rotate(glm::mat4(1.f), acosf(glm::clamp(up.y, -1.f, 1.f)), glm::normalize(axis)) * model;
 
-	if (m_Texture != nullptr)
-		shader.SetUniform1i("u_Texture", 0);
-
-	GLCall(glDrawElements(GL_TRIANGLES, m_Mesh->GetIndexCount(), GL_UNSIGNED_INT, 0));
-
-	UnBind();
-	shader.UnBind();
+	//model = glm::translate(model, m_Position);
+	auto translate = glm::translate(glm::mat4(1.f), position);
+	return translate * model;
 }
 
 void Model::RotateX(float angle)
@@ -0,0 +1,150 @@
+#include "../Public/OcclusionQueries.h"
+#include "../Public/Renderer.h"
+#include "../Public/Camera.h"
+#include "../Public/VertexArray.h"
+#include "../Public/VertexBuffer.h"
+#include "../Public/VertexBufferLayout.h"
+#include <algorithm>
+
+OcclusionQueries::OcclusionQueries(uint count, std::shared_ptr<Shader> boxShader) :
+	m_Entries(count), m_Shader(boxShader)
+{
+	for (Entry& entry : m_Entries)
+	{
+		GLCall(glGenQueries(1, &entry.Query));
+	}
+
+	float corners[] = {
+		-1.f, -1.f, -1.f,	1.f, -1.f, -1.f,	1.f, 1.f, -1.f,		-1.f, 1.f, -1.f,
+		-1.f, -1.f, 1.f,	1.f, -1.f, 1.f,		1.f, 1.f, 1.f,		-1.f, 1.f, 1.f
+	};
+	// two triangles per face, faces aren't culled so the winding doesn't matter
+	uint indices[] = {
+		0, 1, 2, 0, 2, 3,	4, 5, 6, 4, 6, 7,
+		0, 1, 5, 0, 5, 4,	3, 2, 6, 3, 6, 7,
+		0, 3, 7, 0, 7, 4,	1, 2, 6, 1, 6, 5
+	};
+	m_BoxVA = new VertexArray();
+	m_BoxIB = new IndexBuffer(indices, 36);
+	m_BoxVB = new VertexBuffer(corners, sizeof(corners));
+	m_BoxVBL = new VertexBufferLayout();
+	m_BoxVBL->Push<float>(3);
+	m_BoxVA->AddBuffer(*m_BoxVB, *m_BoxVBL);
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+	for (Entry& entry : m_Entries)
+	{
+		GLCall(glDeleteQueries(1, &entry.Query));
+	}
+	delete m_BoxVB;
+	delete m_BoxVBL;
+	delete m_BoxIB;
+	delete m_BoxVA;
+}
+
+void OcclusionQueries::Update(Entry& entry)
+{
+	if (!entry.Pending)
+		return;
+
+	int available = 0;
+	GLCall(glGetQueryObjectiv(entry.Query, GL_QUERY_RESULT_AVAILABLE, &available));
+	if (!available)
+		return;
+	uint anySamples = 0;
+	GLCall(glGetQueryObjectuiv(entry.Query, GL_QUERY_RESULT, &anySamples));
+	entry.Occluded = anySamples == 0;
+	entry.Pending = false;
+}
+
+bool OcclusionQueries::IsOccluded(uint id)
+{
+	Update(m_Entries[id]);
+	return m_Entries[id].Occluded;
+}
+
+void OcclusionQueries::Reset(uint id)
+{
+	m_Entries[id].Occluded = false;
+}
+
+void OcclusionQueries::Begin()
+{
+	for (Entry& entry : m_Entries)
+		entry.Issued = false;
+	m_IssuedQueries = 0;
+
+	m_Shader->Bind();
+	if (Camera::m_CurrCam != nullptr)
+		Camera::m_CurrCam->UpdateUniform(*m_Shader);
+	m_BoxVA->Bind();
+	m_BoxIB->Bind();
+
+	// boxes only test the depth, they must not hide anything drawn after them
+	Renderer::SetEnabled(GL_DEPTH_TEST, true);
+	Renderer::SetColorMask(false, false, false, false);
+	Renderer::SetDepthMask(false);
+}
+
+void OcclusionQueries::Query(uint id, const Model& model, const glm::mat4& modelMatrix)
+{
+	const Mesh& mesh = *model.GetMesh();
+	Entry& entry = m_Entries[id];
+	// a result still in flight is read now or lost, the new query replaces it
+	Update(entry);
+	if (!mesh.HasBounds())
+	{
+		entry.Occluded = false;
+		return;
+	}
+
+	// near plane cutting into the box leaves nothing of its front faces to test, such models count as visible
+	std::shared_ptr<Camera> camera = Camera::m_CurrCam;
+	if (camera != nullptr)
+	{
+		glm::mat3 axes(modelMatrix);
+		float scale = std::max(glm::length(axes[0]), std::max(glm::length(axes[1]), glm::length(axes[2])));
+		glm::vec3 centre = glm::vec3(modelMatrix * glm::vec4(mesh.GetBoundingCentre(), 1.f));
+		if (glm::length(centre - camera->GetPosition()) <= mesh.GetBoundingRadius() * scale + camera->GetNearPlane())
+		{
+			entry.Occluded = false;
+			return;
+		}
+	}
+
+	glm::vec3 boxCentre = 0.5f * (mesh.GetBoundsMin() + mesh.GetBoundsMax());
+	glm::vec3 halfExtent = 0.5f * (mesh.GetBoundsMax() - mesh.GetBoundsMin());
+	glm::mat4 box = modelMatrix * glm::scale(glm::translate(glm::mat4(1.f), boxCentre), halfExtent);
+	m_Shader->SetUniformMatrix4fv("u_Model", glm::value_ptr(box));
+
+	GLCall(glBeginQuery(GL_ANY_SAMPLES_PASSED, entry.Query));
+	GLCall(glDrawElements(GL_TRIANGLES, m_BoxIB->GetCount(), m_BoxIB->GetType(), nullptr));
+	GLCall(glEndQuery(GL_ANY_SAMPLES_PASSED));
+	entry.Pending = true;
+	entry.Issued = true;
+	m_IssuedQueries++;
+}
+
+void OcclusionQueries::End()
+{
+	Renderer::SetColorMask(true, true, true, true);
+	Renderer::SetDepthMask(true);
+}
+
+void OcclusionQueries::BeginConditional(uint id) const
+{
+	if (m_Entries[id].Issued)
+	{
+		GLCall(glBeginConditionalRender(m_Entries[id].Query, GL_QUERY_NO_WAIT));
+	}
+}
+
+void OcclusionQueries::EndConditional(uint id) const
+{
+	if (m_Entries[id].Issued)
+	{
+		GLCall(glEndConditionalRender());
+	}
+}
@@ -0,0 +1,142 @@
+#include "../Public/RenderQueue.h"
+#include "../Public/Camera.h"
+#include <algorithm>
+#include <cstring>
+
+static float CameraDistance(const glm::mat4& model)
+{
+	if (Camera::m_CurrCam == nullptr)
+		return 0.f;
+	return glm::length(glm::vec3(model[3]) - Camera::m_CurrCam->GetPosition());
+}
+
+// the whole frustum of the current camera, nothing is culled without one
+static bool IsVisible(const Model& model, const glm::mat4& modelMatrix)
+{
+	if (Camera::m_CurrCam == nullptr)
+		return true;
+	return model.IsVisible(Camera::m_CurrCam->GetFrustum(), modelMatrix);
+}
+
+unsigned long long RenderQueue::MakeKey(RenderPass pass, uint shader, uint texture, uint mesh, float depth)
+{
+	// bits of a non-negative float sort like the float, the highest ones are enough to order the draws
+	uint depthBits;
+	depth = std::max(depth, 0.f);
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+	depthBits >>= 32 - RENDER_KEY_DEPTH_BITS;
+	if (pass == RP_Transparent)
+		depthBits = ~depthBits;
+
+	unsigned long long key = pass & ((1u << RENDER_KEY_PASS_BITS) - 1);
+	key = (key << RENDER_KEY_SHADER_BITS) | (shader & ((1u << RENDER_KEY_SHADER_BITS) - 1));
+	key = (key << RENDER_KEY_TEXTURE_BITS) | (texture & ((1u << RENDER_KEY_TEXTURE_BITS) - 1));
+	key = (key << RENDER_KEY_MESH_BITS) | (mesh & ((1u << RENDER_KEY_MESH_BITS) - 1));
+	key = (key << RENDER_KEY_DEPTH_BITS) | (depthBits & ((1u << RENDER_KEY_DEPTH_BITS) - 1));
+	return key;
+}
+
+void RenderQueue::Add(const DrawPacket& packet, RenderPass pass, float depth)
+{
+	const Texture* texture = packet.DrawnModel->GetTexture().get();
+	unsigned long long key = MakeKey(pass, packet.DrawShader->GetId(), texture != nullptr ? texture->GetId() : 0,
+		packet.DrawnModel->GetMesh()->GetId(), depth);
+	m_Keys.push_back(std::make_pair(key, (uint)m_Packets.size()));
+	m_Packets.push_back(packet);
+}
+
+void RenderQueue::Submit(const Model& model, Shader& shader, glm::vec4 color, RenderPass pass)
+{
+	glm::mat4 modelMatrix = model.GetModelMatrix();
+	if (!IsVisible(model, modelMatrix))
+	{
+		m_Culled++;
+		return;
+	}
+
+	DrawPacket packet = { &model, &shader, color, model.UpdateLod(), 0, 0 };
+	Add(packet, pass, CameraDistance(modelMatrix));
+}
+
+void RenderQueue::SubmitInstanced(const Model& model, Shader& shader, uint lod, const std::vector<MeshInstance>& instances, RenderPass pass)
+{
+	uint firstInstance = m_Instances.size();
+	float depth = 0.f;
+	for (const MeshInstance& instance : instances)
+	{
+		if (!IsVisible(model, instance.Model))
+		{
+			m_Culled++;
+			continue;
+		}
+		float distance = CameraDistance(instance.Model);
+		depth = m_Instances.size() == firstInstance ? distance : std::min(depth, distance);
+		m_Instances.push_back(instance);
+	}
+	if (m_Instances.size() == firstInstance)
+		return;
+
+	DrawPacket packet = { &model, &shader, glm::vec4(1.f), lod, firstInstance, (uint)m_Instances.size() - firstInstance };
+	Add(packet, pass, depth);
+}
+
+void RenderQueue::Flush()
+{
+	std::sort(m_Keys.begin(), m_Keys.end());
+
+	m_FlushedPackets = m_Packets.size();
+	m_ShaderChanges = 0;
+	m_MeshChanges = 0;
+	m_TextureChanges = 0;
+	m_CulledObjects = m_Culled;
+	m_Culled = 0;
+	m_DrawnObjects = 0;
+	const Shader* shader = nullptr;
+	const Mesh* mesh = nullptr;
+	const Texture* texture = nullptr;
+	for (const std::pair<unsigned long long, uint>& key : m_Keys)
+	{
+		const DrawPacket& packet = m_Packets[key.second];
+		// only what differs from the packet before is bound
+		if (packet.DrawShader != shader)
+		{
+			shader = packet.DrawShader;
+			shader->Bind();
+			m_ShaderChanges++;
+		}
+		const Mesh* packetMesh = packet.DrawnModel->GetMesh().get();
+		if (packetMesh != mesh)
+		{
+			mesh = packetMesh;
+			mesh->Bind();
+			m_MeshChanges++;
+		}
+		const Texture* packetTexture = packet.DrawnModel->GetTexture().get();
+		if (packetTexture != nullptr && packetTexture != texture)
+		{
+			texture = packetTexture;
+			texture->Bind();
+			m_TextureChanges++;
+		}
+
+		m_DrawnObjects += std::max(packet.InstanceCount, 1u);
+		if (packet.InstanceCount > 0)
+		{
+			packet.DrawnModel->SetUniforms(*packet.DrawShader, false);
+			mesh->DrawInstanced(std::min(packet.Lod, mesh->GetLodCount() - 1), &m_Instances[packet.FirstInstance], packet.InstanceCount);
+		}
+		else
+		{
+			packet.DrawShader->SetUniform4f("u_Color", packet.Color.r, packet.Color.g, packet.Color.b, packet.Color.a);
+			packet.DrawnModel->SetUniforms(*packet.DrawShader, true);
+			if (mesh->GetLodCount() > 1)
+				mesh->DrawLod(packet.Lod);
+			else
+				mesh->Draw();
+		}
+	}
+
+	m_Packets.clear();
+	m_Keys.clear();
+	m_Instances.clear();
+}
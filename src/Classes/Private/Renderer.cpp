@@ -8,6 +8,28 @@
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 
+uint Renderer::s_Program = 0;
+uint Renderer::s_VertexArray = 0;
+std::unordered_map<uint, uint> Renderer::s_ElementBuffers;
+uint Renderer::s_ActiveTextureUnit = 0;
+uint Renderer::s_Textures[RENDERER_TEXTURE_UNITS] = {};
+std::unordered_map<uint, bool> Renderer::s_Capabilities;
+uint Renderer::s_BlendSource = RENDERER_UNKNOWN_STATE;
+uint Renderer::s_BlendDestination = RENDERER_UNKNOWN_STATE;
+bool Renderer::s_DepthMask = true;
+uint Renderer::s_DepthFunc = GL_LESS;
+uint Renderer::s_ColorMask = 0xF;
+uint Renderer::s_StateCalls = 0;
+uint Renderer::s_SkippedStateCalls = 0;
+
+// site of the last GLCall, the synchronous debug callback runs inside it
+static const char* s_CallFunction = "";
+static const char* s_CallFile = "";
+static int s_CallLine = 0;
+// every call until GLInitDebugOutput installs the callback
+static uint s_ValidationInterval = GL_VALIDATION_INTERVAL_NO_DEBUG_OUTPUT;
+static uint s_CallsToValidation = 0;
+
 void GLClearError()
 {
 	while (glGetError() != GL_NO_ERROR);
@@ -24,6 +46,55 @@ bool GLLogCall(const char* function, const char* file, int line)
 	return true;
 }
 
+bool GLBeginCall(const char* function, const char* file, int line)
+{
+	s_CallFunction = function;
+	s_CallFile = file;
+	s_CallLine = line;
+
+	if (s_ValidationInterval == 0 || ++s_CallsToValidation < s_ValidationInterval)
+		return false;
+	s_CallsToValidation = 0;
+	GLClearError();
+	return true;
+}
+
+static void GLAPIENTRY GLDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
+{
+	std::cout << "[GL " << (type == GL_DEBUG_TYPE_ERROR ? "ERROR" : "debug") << " " << id << "] " << message
+		<< " (last GLCall " << s_CallFunction << " " << s_CallFile << " " << s_CallLine << ")" << std::endl;
+	ASSERT(type != GL_DEBUG_TYPE_ERROR);
+}
+
+bool GLInitDebugOutput()
+{
+	// core in 4.3, an extension before
+	if (!GLEW_VERSION_4_3 && !GLEW_KHR_debug)
+		return false;
+
+	GLint flags = 0;
+	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+	if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+		return false;
+
+	// synchronous - the callback runs inside the call that caused the message, so the recorded site is its own
+	Renderer::SetEnabled(GL_DEBUG_OUTPUT, true);
+	Renderer::SetEnabled(GL_DEBUG_OUTPUT_SYNCHRONOUS, true);
+	GLCall(glDebugMessageCallback(GLDebugCallback, nullptr));
+	// notifications (buffer placement and the like) would flood the console
+	GLCall(glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE));
+
+	s_ValidationInterval = 0;
+	s_CallsToValidation = 0;
+	return true;
+}
+
+void GLSetValidationInterval(uint interval)
+{
+	s_ValidationInterval = interval;
+	s_CallsToValidation = 0;
+}
+
 void Renderer::Clear() const
 {
 	// Clean the back buffer and assign the new color to it
@@ -38,5 +109,166 @@ void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader&
 	va.Bind();
 	ib.Bind();
 
-	GLCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
+	GLCall(glDrawElements(ib.GetMode(), ib.GetCount(), ib.GetType(), nullptr));
+}
+
+void Renderer::UseProgram(uint program)
+{
+	if (program == s_Program)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	GLCall(glUseProgram(program));
+	s_Program = program;
+	s_StateCalls++;
+}
+
+void Renderer::BindVertexArray(uint vertexArray)
+{
+	if (vertexArray == s_VertexArray)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	GLCall(glBindVertexArray(vertexArray));
+	s_VertexArray = vertexArray;
+	s_StateCalls++;
+}
+
+void Renderer::BindElementBuffer(uint buffer)
+{
+	auto bound = s_ElementBuffers.find(s_VertexArray);
+	if (bound != s_ElementBuffers.end() && bound->second == buffer)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer));
+	s_ElementBuffers[s_VertexArray] = buffer;
+	s_StateCalls++;
+}
+
+void Renderer::BindTexture(uint unit, uint texture)
+{
+	if (unit < RENDERER_TEXTURE_UNITS && s_Textures[unit] == texture)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	if (unit != s_ActiveTextureUnit)
+	{
+		GLCall(glActiveTexture(GL_TEXTURE0 + unit));
+		s_ActiveTextureUnit = unit;
+		s_StateCalls++;
+	}
+	else
+	{
+		s_SkippedStateCalls++;
+	}
+	GLCall(glBindTexture(GL_TEXTURE_2D, texture));
+	if (unit < RENDERER_TEXTURE_UNITS)
+		s_Textures[unit] = texture;
+	s_StateCalls++;
+}
+
+void Renderer::SetEnabled(uint capability, bool enabled)
+{
+	auto current = s_Capabilities.find(capability);
+	if (current != s_Capabilities.end() && current->second == enabled)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	if (enabled)
+	{
+		GLCall(glEnable(capability));
+	}
+	else
+	{
+		GLCall(glDisable(capability));
+	}
+	s_Capabilities[capability] = enabled;
+	s_StateCalls++;
+}
+
+void Renderer::SetBlendFunc(uint source, uint destination)
+{
+	if (source == s_BlendSource && destination == s_BlendDestination)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	GLCall(glBlendFunc(source, destination));
+	s_BlendSource = source;
+	s_BlendDestination = destination;
+	s_StateCalls++;
+}
+
+void Renderer::SetDepthMask(bool write)
+{
+	if (write == s_DepthMask)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	GLCall(glDepthMask(write ? GL_TRUE : GL_FALSE));
+	s_DepthMask = write;
+	s_StateCalls++;
+}
+
+void Renderer::SetDepthFunc(uint func)
+{
+	if (func == s_DepthFunc)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	GLCall(glDepthFunc(func));
+	s_DepthFunc = func;
+	s_StateCalls++;
+}
+
+void Renderer::SetColorMask(bool red, bool green, bool blue, bool alpha)
+{
+	uint mask = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) | (alpha ? 8 : 0);
+	if (mask == s_ColorMask)
+	{
+		s_SkippedStateCalls++;
+		return;
+	}
+	GLCall(glColorMask(red, green, blue, alpha));
+	s_ColorMask = mask;
+	s_StateCalls++;
+}
+
+void Renderer::ForgetProgram(uint program)
+{
+	// a deleted program stays in use until another one is, its name can't come back before
+	if (program == s_Program)
+		s_Program = RENDERER_UNKNOWN_STATE;
+}
+
+void Renderer::ForgetVertexArray(uint vertexArray)
+{
+	// deleting the bound vertex array binds 0
+	if (vertexArray == s_VertexArray)
+		s_VertexArray = 0;
+	s_ElementBuffers.erase(vertexArray);
+}
+
+void Renderer::ForgetElementBuffer(uint buffer)
+{
+	// vertex arrays other than the bound one keep referencing the deleted buffer, a new buffer with its name has to be bound again
+	for (auto& bound : s_ElementBuffers)
+		if (bound.second == buffer)
+			bound.second = RENDERER_UNKNOWN_STATE;
+}
+
+void Renderer::ForgetTexture(uint texture)
+{
+	// deleting a texture unbinds it from every unit
+	for (uint& bound : s_Textures)
+		if (bound == texture)
+			bound = 0;
 }
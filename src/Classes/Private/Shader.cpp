@@ -4,19 +4,21 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <algorithm>
 
 std::shared_ptr<Shader> Shader::m_CurrShader = nullptr;
 
-Shader::Shader(const std::string& filepath) : 
-	m_Filepath(filepath)
+Shader::Shader(const std::string& filepath, const std::vector<std::string>& defines, const std::vector<std::string>& feedbackVaryings) : 
+	m_Filepath(filepath), m_Defines(defines), m_FeedbackVaryings(feedbackVaryings)
 {
 	ShaderSource source = ParseShader(filepath);
-	m_Renderer_Id = CreateShader(source.VertexSource, source.FragmentSource);
+	m_Renderer_Id = CreateShader(source);
 }
 
 Shader::~Shader()
 {
 	GLCall(glDeleteProgram(m_Renderer_Id));
+	Renderer::ForgetProgram(m_Renderer_Id);
 }
 
 ShaderSource Shader::ParseShader(const std::string& file)
@@ -28,32 +30,49 @@ ShaderSource Shader::ParseShader(const std::string& file)
 		NONE = -1,
 		VERTEX = 0,
 		FRAGMENT = 1,
+		TESS_CONTROL = 2,
+		TESS_EVALUATION = 3,
 	};
 
 	std::string line;
-	std::stringstream ss[2];
+	std::stringstream ss[4];
 	ShaderType type = ShaderType::NONE;
 	while (getline(stream, line))
 	{
 		if (line.find("#shader") != std::string::npos)
 		{
-			if (line.find("vertex") != std::string::npos)
+			if (line.find("tess_control") != std::string::npos)
+				type = ShaderType::TESS_CONTROL;
+			else if (line.find("tess_evaluation") != std::string::npos)
+				type = ShaderType::TESS_EVALUATION;
+			else if (line.find("vertex") != std::string::npos)
 				type = ShaderType::VERTEX;
 			else if (line.find("fragment") != std::string::npos)
 				type = ShaderType::FRAGMENT;
 
+			// "#shader <stage> <DEFINE>" - stage used only by variants built with DEFINE
+			std::stringstream words(line);
+			std::string word, stage, define;
+			words >> word >> stage >> define;
+			if (!define.empty() && std::find(m_Defines.begin(), m_Defines.end(), define) == m_Defines.end())
+				type = ShaderType::NONE;
 		}
-		else
+		else if (type != ShaderType::NONE)
 		{
 			ss[(int)type] << line << '\n';
 		}
 	}
 
-	return { ss[0].str(), ss[1].str() };
+	return { ss[0].str(), ss[1].str(), ss[2].str(), ss[3].str() };
 }
 
-uint Shader::CompileShader(uint type, const std::string& source)
+uint Shader::CompileShader(uint type, std::string source)
 {
+	// defines have to follow #version
+	size_t versionEnd = source.find('\n', source.find("#version")) + 1;
+	for (const std::string& define : m_Defines)
+		source.insert(versionEnd, "#define " + define + "\n");
+
 	uint id = glCreateShader(type);
 	const char* src = source.c_str();
 
@@ -80,31 +99,63 @@ uint Shader::CompileShader(uint type, const std::string& source)
 	return id;
 }
 
-uint Shader::CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
+uint Shader::CreateShader(const ShaderSource& source)
 {
 	uint program = glCreateProgram();
-	uint vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
-	uint fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
-
+	uint vs = CompileShader(GL_VERTEX_SHADER, source.VertexSource);
 	glAttachShader(program, vs);
-	glAttachShader(program, fs);
+
+	// transform feedback only programs don't rasterize, so they need no fragment stage
+	uint fs = 0;
+	if (!source.FragmentSource.empty())
+	{
+		fs = CompileShader(GL_FRAGMENT_SHADER, source.FragmentSource);
+		glAttachShader(program, fs);
+	}
+
+	// both tessellation stages or none, need a 4.0 context
+	uint tcs = 0;
+	uint tes = 0;
+	if (!source.TessControlSource.empty() && !source.TessEvaluationSource.empty())
+	{
+		tcs = CompileShader(GL_TESS_CONTROL_SHADER, source.TessControlSource);
+		tes = CompileShader(GL_TESS_EVALUATION_SHADER, source.TessEvaluationSource);
+		glAttachShader(program, tcs);
+		glAttachShader(program, tes);
+	}
+
+	// captured outputs have to be known before linking
+	if (!m_FeedbackVaryings.empty())
+	{
+		std::vector<const char*> varyings;
+		for (const std::string& varying : m_FeedbackVaryings)
+			varyings.push_back(varying.c_str());
+		glTransformFeedbackVaryings(program, varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+	}
+
 	glLinkProgram(program);
 	glValidateProgram(program);
 
 	glDeleteShader(vs);
-	glDeleteShader(fs);
+	if (fs != 0)
+		glDeleteShader(fs);
+	if (tcs != 0)
+	{
+		glDeleteShader(tcs);
+		glDeleteShader(tes);
+	}
 
 	return program;
 }
 
 void Shader::Bind() const
 {
-	GLCall(glUseProgram(m_Renderer_Id));
+	Renderer::UseProgram(m_Renderer_Id);
 }
 
 void Shader::UnBind() const
 {
-	GLCall(glUseProgram(0));
+	Renderer::UseProgram(0);
 }
 
 void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
@@ -122,6 +173,16 @@ void Shader::SetUniform3f(const std::string& name, glm::vec3 vec)
 	GLCall(glUniform3f(GetUniformLocation(name), vec.x, vec.y, vec.z));
 }
 
+void Shader::SetUniform4fv(const std::string& name, int count, const float* values)
+{
+	GLCall(glUniform4fv(GetUniformLocation(name), count, values));
+}
+
+void Shader::SetUniform1fv(const std::string& name, int count, const float* values)
+{
+	GLCall(glUniform1fv(GetUniformLocation(name), count, values));
+}
+
 void Shader::SetUniformMatrix4f(const std::string& name, glm::mat4& matrix)
 {
 	GLCall(glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]));
@@ -137,12 +198,18 @@ void Shader::SetUniform1i(const std::string& name, int value)
 	GLCall(glUniform1i(GetUniformLocation(name), value));
 }
 
+void Shader::SetUniform1f(const std::string& name, float value)
+{
+	GLCall(glUniform1f(GetUniformLocation(name), value));
+}
+
 int Shader::GetUniformLocation(const std::string& name)
 {
 	if (m_LocationCache.find(name) != m_LocationCache.end())
 		return m_LocationCache[name];
 
-	GLCall(int location = glGetUniformLocation(m_Renderer_Id, name.c_str()));
+	int location;
+	GLCall(location = glGetUniformLocation(m_Renderer_Id, name.c_str()));
 	if (location == -1)
 	{
 		std::cout << "Warning uniform " << name << " doesnt exist\n";
@@ -1,12 +1,47 @@
 #include "../Public/Texture.h"
 #include "../Public/stb_image.h"
 
+TextureData::~TextureData()
+{
+	if (Pixels)
+		stbi_image_free(Pixels);
+}
+
+bool Texture::Decode(const std::string& path, TextureData& data)
+{
+	// the flag is per thread, decoders on worker threads don't race on it
+	stbi_set_flip_vertically_on_load_thread(1);
+	data.FilePath = path;
+	data.Pixels = stbi_load(path.c_str(), &data.Width, &data.Height, &data.BPP, 4);
+	if (data.Pixels == nullptr)
+	{
+		std::cout << "Texture " << path << " couldn't be loaded: " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+	return true;
+}
+
 Texture::Texture(const std::string& path) 
 	: m_RendererID(0), m_FilePath(path), m_LocalBuffer(nullptr),
 	m_Width(0), m_Height(0), m_BPP(0)
 {
-	stbi_set_flip_vertically_on_load(1);
-	m_LocalBuffer = stbi_load(path.c_str(), &m_Width, &m_Height, &m_BPP, 4);
+	TextureData data;
+	Decode(path, data);
+	Create(data);
+}
+
+Texture::Texture(const TextureData& data)
+	: m_RendererID(0), m_FilePath(data.FilePath), m_LocalBuffer(nullptr),
+	m_Width(0), m_Height(0), m_BPP(0)
+{
+	Create(data);
+}
+
+void Texture::Create(const TextureData& data)
+{
+	m_Width = data.Width;
+	m_Height = data.Height;
+	m_BPP = data.BPP;
 
 	GLCall(glGenTextures(1, &m_RendererID));
 	Bind();
@@ -17,26 +52,22 @@ Texture::Texture(const std::string& path)
 	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
 	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
 
-	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_LocalBuffer));
-	UnBind();
-
-	if (m_LocalBuffer)
-		stbi_image_free(m_LocalBuffer);
+	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.Pixels));
 }
 
 Texture::~Texture()
 {
 	GLCall(glDeleteTextures(1, &m_RendererID));
+	Renderer::ForgetTexture(m_RendererID);
 }
 
 void Texture::Bind(uint slot) const
 {
 	// slot is a slot in texture 
-	GLCall(glActiveTexture(GL_TEXTURE0 + slot));
-	GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+	Renderer::BindTexture(slot, m_RendererID);
 }
 
 void Texture::UnBind() const
 {
-	GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+	Renderer::BindTexture(0, 0);
 }
@@ -0,0 +1,114 @@
+#include "../Public/ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint threadCount) :
+	m_Busy(false), m_NextBand(0), m_BandsLeft(0)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint i = 1; i < threadCount; i++)
+		m_Workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_WorkReady.notify_all();
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::ParallelFor(int bandCount, Job job, void* context)
+{
+	if (bandCount <= 0)
+		return;
+
+	if (m_Workers.empty() || bandCount == 1)
+	{
+		for (int band = 0; band < bandCount; band++)
+			job(context, band);
+		return;
+	}
+
+	// another caller has the workers (e.g. the board's background tick, the table on the render thread), don't wait for it
+	if (m_Busy.exchange(true, std::memory_order_acquire))
+	{
+		for (int band = 0; band < bandCount; band++)
+			job(context, band);
+		return;
+	}
+
+	{
+		// a worker waking up late for the previous job may still be looking at its bands
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WorkDone.wait(lock, [this]() { return m_ActiveWorkers == 0; });
+
+		m_Job = job;
+		m_Context = context;
+		m_BandCount = bandCount;
+		m_NextBand = 0;
+		m_BandsLeft = bandCount;
+		m_Generation++;
+	}
+	m_WorkReady.notify_all();
+
+	// caller works too instead of just waiting
+	RunBands(job, context, bandCount);
+
+	// job can't change until every worker that took it has left, so a worker never runs bands of another job
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WorkDone.wait(lock, [this]() { return m_BandsLeft == 0 && m_ActiveWorkers == 0; });
+	}
+	m_Busy.store(false, std::memory_order_release);
+}
+
+void ThreadPool::RunBands(Job job, void* context, int bandCount)
+{
+	for (int band = m_NextBand++; band < bandCount; band = m_NextBand++)
+	{
+		job(context, band);
+		m_BandsLeft--;
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	uint seenGeneration = 0;
+	while (true)
+	{
+		Job job;
+		void* context;
+		int bandCount;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkReady.wait(lock, [&]() { return m_Stop || m_Generation != seenGeneration; });
+			if (m_Stop)
+				return;
+
+			seenGeneration = m_Generation;
+			job = m_Job;
+			context = m_Context;
+			bandCount = m_BandCount;
+			m_ActiveWorkers++;
+		}
+
+		RunBands(job, context, bandCount);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_ActiveWorkers--;
+		}
+		m_WorkDone.notify_one();
+	}
+}
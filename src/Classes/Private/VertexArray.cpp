@@ -1,7 +1,8 @@
 #include "../Public/VertexArray.h"
 #include "../Public/Renderer.h"
 
-VertexArray::VertexArray()
+VertexArray::VertexArray() :
+	m_AttribCount(0)
 {
 	GLCall(glGenVertexArrays(1, &m_Renderer_Id));
 }
@@ -9,9 +10,10 @@ VertexArray::VertexArray()
 VertexArray::~VertexArray()
 {
 	GLCall(glDeleteVertexArrays(1, &m_Renderer_Id));
+	Renderer::ForgetVertexArray(m_Renderer_Id);
 }
 
-void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout)
+void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout, uint divisor)
 {
 	Bind();
 	vb.Bind();
@@ -20,19 +22,24 @@ void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& la
 	for (uint i = 0; i < elements.size(); i++)
 	{
 		const auto& element = elements[i];
-		GLCall(glEnableVertexAttribArray(i));
-		GLCall(glVertexAttribPointer(i, element.count, element.type, element.normalized, layout.GetStride(),
+		GLCall(glEnableVertexAttribArray(m_AttribCount + i));
+		GLCall(glVertexAttribPointer(m_AttribCount + i, element.count, element.type, element.normalized, layout.GetStride(),
 			(const void*)offset));
-		offset += element.count * VertexElement::GetSizeOfType(element.type);
+		if (divisor != 0)
+		{
+			GLCall(glVertexAttribDivisor(m_AttribCount + i, divisor));
+		}
+		offset += element.GetSize();
 	}
+	m_AttribCount += elements.size();
 }
 
 void VertexArray::Bind() const
 {
-	GLCall(glBindVertexArray(m_Renderer_Id));
+	Renderer::BindVertexArray(m_Renderer_Id);
 }
 
 void VertexArray::UnBind() const
 {
-	GLCall(glBindVertexArray(0));
+	Renderer::BindVertexArray(0);
 }
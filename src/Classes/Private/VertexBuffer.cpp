@@ -1,12 +1,17 @@
 #include "../Public/VertexBuffer.h"
 #include "../Public/Renderer.h"
 
-VertexBuffer::VertexBuffer(const void* data, uint size)
+uint VertexBuffer::s_UploadedBytes = 0;
+
+VertexBuffer::VertexBuffer(const void* data, uint size, uint usage) :
+	m_Size(size), m_Usage(usage)
 {
 	GLCall(glGenBuffers(1, &m_Renderer_ID));
 	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Renderer_ID));
-	GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+	GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, usage));
 
+	if (data != nullptr)
+		s_UploadedBytes += size;
 }
 
 VertexBuffer::~VertexBuffer()
@@ -14,11 +19,41 @@ VertexBuffer::~VertexBuffer()
 	GLCall(glDeleteBuffers(1, &m_Renderer_ID));
 }
 
+void VertexBuffer::Update(const void* data, uint size, uint offset)
+{
+	ASSERT(offset + size <= m_Size);
+
+	Bind();
+	if (offset == 0)
+	{
+		// orphan previous storage
+		GLCall(glBufferData(GL_ARRAY_BUFFER, m_Size, nullptr, m_Usage));
+	}
+	GLCall(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+
+	s_UploadedBytes += size;
+}
+
+void VertexBuffer::Reserve(uint size)
+{
+	if (size <= m_Size)
+		return;
+
+	m_Size = size;
+	Bind();
+	GLCall(glBufferData(GL_ARRAY_BUFFER, m_Size, nullptr, m_Usage));
+}
+
 void VertexBuffer::Bind() const
 {
 	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Renderer_ID));
 }
 
+void VertexBuffer::BindFeedback(uint index) const
+{
+	GLCall(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, index, m_Renderer_ID));
+}
+
 void VertexBuffer::UnBind() const
 {
 	GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
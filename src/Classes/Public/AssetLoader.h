@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Typedef.h"
+#include "Mesh.h"
+#include "Texture.h"
+
+// Loads a batch of meshes and textures in parallel. Files are read, imported and decoded on worker threads,
+// finished assets go to a completion queue the calling thread empties, creating their GL objects as they come,
+// so the batch takes about as long as its slowest asset instead of the sum of all of them.
+class AssetLoader
+{
+private:
+	enum AssetType { AT_Mesh, AT_Texture };
+
+	struct Asset
+	{
+		AssetType Type;
+		std::string Path;
+		// requests of the same path share one load
+		std::vector<std::shared_ptr<Mesh>*> MeshTargets;
+		std::vector<std::shared_ptr<Texture>*> TextureTargets;
+
+		MeshData MeshResult;
+		TextureData TextureResult;
+		bool Loaded = false;
+		// worker side (read, import, decode) and context thread side (GL objects), ms
+		float LoadTime = 0.f;
+		float CreateTime = 0.f;
+	};
+
+	std::vector<std::unique_ptr<Asset>> m_Assets;
+
+	std::atomic<int> m_NextAsset;
+	std::mutex m_QueueMutex;
+	std::condition_variable m_AssetLoaded;
+	// indices of loaded assets waiting for their GL objects
+	std::vector<int> m_Completed;
+
+public:
+	AssetLoader() : m_NextAsset(0) { }
+
+	// target is set by Finish, it has to stay valid until then
+	void LoadMesh(const std::string& path, std::shared_ptr<Mesh>* target);
+	void LoadTexture(const std::string& path, std::shared_ptr<Texture>* target);
+
+	// Loads everything requested since the last Finish, on the thread owning the GL context. Targets of assets
+	// that failed to load stay nullptr. printTimings - one line per asset and the totals
+	void Finish(bool printTimings = true);
+
+private:
+	Asset& GetAsset(AssetType type, const std::string& path);
+	void WorkerLoop();
+	void CreateObjects(Asset& asset);
+};
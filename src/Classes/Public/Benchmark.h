@@ -0,0 +1,14 @@
+#pragma once
+
+// Measurements started with the --benchmark command line argument.
+// They print to the console and need a current GL context, because meshes create their buffers on construction.
+// Direct CalZ/CalN evaluation against the cached basis tables, at a few precisions
+void RunBezierBenchmark();
+// Same tessellation split between different numbers of worker threads, for different grid sizes
+void RunBezierThreadingBenchmark();
+// Multi-patch terrain tessellated by forward differencing, time per vertex for a few sizes
+void RunBezierTerrainBenchmark();
+// Frame of simulated render work plus a Bezier tick, ticked on the render thread and in the background
+void RunBezierAsyncTickBenchmark();
+// Index buffer sizes and post-transform cache efficiency (ACMR) of the board, the table and the pieces
+void RunIndexOrderBenchmark();
@@ -6,8 +6,12 @@
 
 #include "Renderer.h"
 #include "Mesh.h"
+#include "BezierKernel.h"
+#include "ThreadPool.h"
+#include "../../enums/BezierMode.h"
 
-#define BEZIER_DEGREE 4
+// surface is split into BEZIER_TILES x BEZIER_TILES tiles (one per board square), each with its own level of detail
+#define BEZIER_TILES 8
 
 class Bezier : Mesh
 {
@@ -26,29 +30,200 @@ private:
 		{0.07f, 0.1f}
 	};
 	float m_MaxHeight = 0.15f;
-	std::vector<float> m_PositionTextureNormal;
-	float m_ZArray[];
+	BezierMode m_Mode;
+	// tessellation is split into row bands on this pool once the grid is big enough
+	ThreadPool* m_ThreadPool;
+	// BM_CPU - per vertex height and its x, y derivatives, the only data uploaded every tick
+	std::vector<float> m_HeightSlope;
+	// second vertex stream next to the static (u, v) grid in m_VB, written by the GPU in BM_TransformFeedback mode
+	VertexBuffer* m_DynamicVB = nullptr;
+	VertexBufferLayout* m_DynamicVBL = nullptr;
+	// static stream next to the grid in the modes evaluating the surface on the GPU, see TileLayout::MorphEnds
+	VertexBuffer* m_MorphVB = nullptr;
+	VertexBufferLayout* m_MorphVBL = nullptr;
+	// BM_TransformFeedback - evaluation pass reading only the grid, m_VA can't be used as it also reads m_DynamicVB
+	Shader* m_FeedbackShader = nullptr;
+	VertexArray* m_FeedbackVA = nullptr;
 
-public:
-	Bezier(int prcision = 50);
-	float CalZ(float x, float y);
-	void Tick(float interval);
+	// grid quads along a tile side at the finest level, power of two
+	int m_TileSize;
+	// grid step of every tile, tile (x, y) at [y * BEZIER_TILES + x], 1 - finest, m_TileSize - two triangles per tile
+	std::vector<int> m_TileSteps;
+	// vertex the next coarser level of its tile doesn't have, blended onto the coarser edge under it before the switch
+	struct MorphVertex
+	{
+		// grid index and index in the active vertices
+		int Vertex;
+		int Active;
+		// grid indices of the ends of that edge, the vertex lies half way between them
+		int Ends[2];
+		// tiles drawing it at this level, the larger of their morph factors is used, -1 - none
+		int Tiles[2];
+	};
+	// vertices and triangles of every tile at its grid step
+	struct TileLayout
+	{
+		// m_TileSteps the layout was built from
+		std::vector<int> TileSteps;
+		// grid indices (row * (precision + 1) + column) of vertices used by any tile, sorted,
+		// vertex k of both vertex buffers is grid vertex ActiveVertices[k]
+		std::vector<int> ActiveVertices;
+		// first active vertex of every grid row, size precision + 2, row i is not used when RowStart[i] == RowStart[i + 1]
+		std::vector<int> RowStart;
+		// (u, v) of the active vertices and the triangles, as uploaded to m_VB and m_IB
+		std::vector<float> Grid;
+		std::vector<uint> Indices;
+		// morphed by Tessellate (BM_CPU) or on the GPU, so a tile looks like its coarser level by the time it switches
+		std::vector<MorphVertex> Morphs;
+		// BM_VertexShader and BM_TransformFeedback - Morphs per active vertex as uploaded to m_MorphVB:
+		// (u, v) of both ends and the two tiles, a vertex that doesn't morph is its own ends with no tiles
+		std::vector<float> MorphEnds;
+	};
+	// layout in the buffers, drawn
+	TileLayout m_Layout;
+	// after EnableAsyncTick - layout of new tile levels, drawn once a tick made for it is collected
+	TileLayout m_NextLayout;
+	bool m_LayoutChanged = false;
+	// quads along a tile side UpdateLevelOfDetail wanted, the morph factor of a tile follows it between levels
+	float m_TileWanted[BEZIER_TILES * BEZIER_TILES];
+	// BM_CPU - m_HeightSlope of the active vertices only, uploaded when not every vertex is used
+	std::vector<float> m_ActiveHeightSlope;
 
-	float GetVertexZ(int i, int j);
+	// BM_CPU after EnableAsyncTick - the next tick is made on m_TickThread into the back buffers while the current one
+	// is drawn, the back buffers are swapped with m_ControlPoints, m_HeightSlope and m_ActiveHeightSlope when it is collected.
+	// The render thread never waits for it, a tick that isn't finished is collected by a later Tick.
+	float m_BackControlPoints[BEZIER_DEGREE][BEZIER_DEGREE] = { 0 };
+	float m_BackTileWanted[BEZIER_TILES * BEZIER_TILES];
+	std::vector<float> m_BackHeightSlope;
+	std::vector<float> m_BackActiveHeightSlope;
+	bool m_AsyncTick = false;
+	std::thread m_TickThread;
+	// workers of m_TickThread only, tessellations on the render thread (e.g. the table) don't compete for them
+	ThreadPool* m_TickPool = nullptr;
+	// only wakes m_TickThread, not held while it tessellates
+	std::mutex m_TickMutex;
+	std::condition_variable m_TickRequested;
+	// the back buffers belong to m_TickThread while true, it clears it (release) once they are written
+	std::atomic<bool> m_TickPending;
+	bool m_StopTick = false;
+	float m_TickInterval = 0.f;
+	// m_Layout or m_NextLayout, the one the started tick tessellates
+	const TileLayout* m_TickLayout = nullptr;
+	// render thread only: a tick was started and not collected yet
+	bool m_TickStarted = false;
+	// time of frames that couldn't start a tick as the last one was still running, added to the next one
+	float m_SkippedInterval = 0.f;
+	// ticks made current, in either mode
+	uint m_Ticks = 0;
 
-private:
-	void UpdateArrays();
-	glm::vec3 CalN(float x, float y);
-	float B(int i, int n, float t);
-	int factorial(int n)
+	// Bernstein basis sampled at every grid coordinate k / m_TriangulationPrecision,
+	// one array per basis function: B(i, degree, k / precision) at [i * (precision + 1) + k]
+	std::vector<float> m_Basis;
+	// derivative of the basis (degree lowered by one, already multiplied by degree), laid out the same way
+	std::vector<float> m_BasisDerivative;
+
+	// the same two tables sampled at tile centres (k + 0.5) / BEZIER_TILES
+	float m_CentreBasis[BEZIER_DEGREE * BEZIER_TILES];
+	float m_CentreBasisDerivative[(BEZIER_DEGREE - 1) * BEZIER_TILES];
+	// height, dHeight/dx, dHeight/dy at every tile centre, tile (x, y) at [(x * BEZIER_TILES + y) * BEZIER_VERTEX_SIZE],
+	// exact in every mode, updated by Tick
+	float m_TileCentres[BEZIER_TILES * BEZIER_TILES * BEZIER_VERTEX_SIZE];
+
+public:
+	// prcision is rounded up to BEZIER_TILES times a power of two, so every tile level is a power of two step
+	Bezier(int prcision = 50, BezierMode mode = BM_CPU);
+	~Bezier();
+	float CalZ(float x, float y);
+	// Bernstein basis polynomial i of degree n at t, shared by every patch evaluator (e.g. BezierTerrain)
+	static float B(int i, int n, float t);
+	static int factorial(int n)
 	{
 		int result = 1;
 		for (int i = 1; i <= n; i++)
 			result *= i;
 		return result;
 	}
+	// Moves the control points and updates the surface data of the mode.
+	// After EnableAsyncTick a finished background tick becomes current and the next one is started,
+	// while the last one is still running the current one stays and interval goes to the next.
+	void Tick(float interval);
+	// BM_CPU only: ticks are tessellated on a background thread, one frame ahead of the one drawn
+	void EnableAsyncTick();
+
+	BezierMode GetMode() const { return m_Mode; };
+	uint GetTicks() const { return m_Ticks; };
+	// define the surface shader (Phong.shader variant) has to be built with for this mode
+	std::string GetShaderDefine() const;
+	// Sends per tick data the shader needs to draw the surface (control points in BM_VertexShader and BM_Tessellation modes)
+	// shader has to be bound
+	void SetUniforms(Shader& shader) const;
+	// BM_Tessellation draws the control points as one patch of 16 vertices, the other modes triangles
+	void Draw() const override;
+
+	// surface height at the centre of tile (x, y), x along the first surface coordinate
+	float GetTileHeight(int x, int y) const { return m_TileCentres[(x * BEZIER_TILES + y) * BEZIER_VERTEX_SIZE]; };
+	// unit surface normal at the centre of tile (x, y), in mesh space (y up)
+	glm::vec3 GetTileNormal(int x, int y) const;
+
+	// Picks the grid step of every tile from its projected size and the surface curvature in it,
+	// rebuilds the index buffer and the active vertex set when any tile changed, returns true then.
+	// mvp - camera matrix * model matrix of the board, viewportHeight in pixels.
+	// Has to be followed by Tick before the next draw in BM_CPU mode, so the new vertices get their heights.
+	// After EnableAsyncTick the buffers are rebuilt by the Tick that collects the first tick made with the new levels,
+	// and the levels don't change while that one is running.
+	bool UpdateLevelOfDetail(const glm::mat4& mvp, float viewportHeight);
+	// vertices drawn, 0 in BM_Tessellation mode where the GPU makes them
+	uint GetActiveVertexCount() const { return m_Layout.ActiveVertices.size(); };
+
+	// Recalculates heights and slopes of all vertices from the cached basis tables, CPU side only
+	void Tessellate();
+	// pool used by Tessellate, nullptr - always single threaded
+	void SetThreadPool(ThreadPool* pool) { m_ThreadPool = pool; };
+	// Same result as Tessellate, but every vertex is evaluated directly with CalZ and CalN
+	void TessellateDirect();
+
+private:
+	void UpdateArrays();
+	void UploadHeightSlope();
+	// activeHeightSlope sized for the active vertices of layout, empty when every vertex is used
+	void ResizeActiveHeightSlope(const TileLayout& layout, std::vector<float>& activeHeightSlope) const;
+	void MoveControlPoints(float controlPoints[BEZIER_DEGREE][BEZIER_DEGREE], float interval);
+	void TessellateInto(const float controlPoints[BEZIER_DEGREE][BEZIER_DEGREE], const TileLayout& layout, const float* tileWanted,
+		ThreadPool* pool, std::vector<float>& heightSlope, std::vector<float>& activeHeightSlope);
+	// 0 - tile drawn with its own heights, 1 - exactly like its next coarser level
+	float GetMorphFactor(int step, float wanted) const;
+	// factor of every tile, false when all are 0
+	bool GetMorphFactors(const std::vector<int>& tileSteps, const float* tileWanted, float factors[BEZIER_TILES * BEZIER_TILES]) const;
+	// blends layout.Morphs of tessellated heightSlope, into activeHeightSlope unless it is empty
+	void MorphVertices(const TileLayout& layout, const float* tileWanted, std::vector<float>& heightSlope, std::vector<float>& activeHeightSlope) const;
+	// async ticks: start one on m_TickThread, collect its results on the render thread when it is finished (returns true then)
+	void StartTick(float interval);
+	bool FinishTick();
+	void TickLoop();
+	// BM_TransformFeedback - evaluates all active vertices on the GPU into m_DynamicVB
+	void RunFeedback();
+	void BuildBasisTables();
+	// BM_Tessellation - buffers of the single patch, no grid
+	void BuildPatch();
+	void BuildCentreBasis();
+	void UpdateTileCentres();
+	// the surface lies in the convex hull of the control points: (u, v) in [0, 1], height between the lowest and highest one
+	void UpdateBounds();
+	// builds indices of all tiles, the active vertex set and the (u, v) grid from m_TileSteps
+	void BuildLayout(TileLayout& layout) const;
+	// BuildLayout into m_Layout and its upload
+	void BuildMesh();
+	void UploadLayout();
+	// tile grid coordinate a moved onto the coarser step of the neighbouring tile, keeps shared edges crack free
+	int SnapToStep(int a, int step) const { return (a + step / 2) / step * step; };
+	void TessellateRows(int first, int last, const float controlPoints[BEZIER_DEGREE][BEZIER_DEGREE], const TileLayout& layout,
+		float* heightSlope, std::vector<float>& activeHeightSlope);
+	glm::vec3 CalN(float x, float y);
+	// larger of |d2z/dx2| and |d2z/dy2|
+	float CalCurvature(float x, float y);
 
 	void SetVertexZ(int i, int j, float value);
 
+	// stores normal as the slopes it was calculated from
 	void SetVertexN(int i, int j, glm::vec3 value);
-};
\ No newline at end of file
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#define BEZIER_DEGREE 4
+// floats per vertex in the streamed part of the Bezier mesh: height, dHeight/dx, dHeight/dy
+#define BEZIER_VERTEX_SIZE 3
+
+// Evaluates one row of the Bezier grid (fixed x, all samples in y) and writes height and its derivatives
+// straight into BEZIER_VERTEX_SIZE float vertices. Normal is normalize(-dx, 1, -dy), left for the vertex shader.
+// curve - control points collapsed along x for this row, curveDx - the same for the x derivative
+// basis - BEZIER_DEGREE arrays of samples values, basis function i at basis[i * samples + j]
+// basisDerivative - BEZIER_DEGREE - 1 arrays of samples values, laid out the same way
+// Uses AVX2 or SSE2 depending on the instruction set the project is compiled for, plain C++ otherwise.
+void EvaluateBezierRow(const float* curve, const float* curveDx, const float* basis, const float* basisDerivative,
+	int samples, float* vertices);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <math.h>
+
+#include "Renderer.h"
+#include "Mesh.h"
+#include "BezierKernel.h"
+#include "ThreadPool.h"
+
+// Surface made of patchesX x patchesY bicubic Bezier patches, each 1 x 1 unit, joined with C1 continuous seams.
+// Uses the same vertex streams as Bezier in BM_CPU mode: static (x, y) grid and streamed height, dHeight/dx, dHeight/dy,
+// so it is drawn with the BEZIER_STREAM variant of Phong.shader.
+class BezierTerrain : Mesh
+{
+private:
+	int m_PatchesX;
+	int m_PatchesY;
+	// grid quads along a patch side
+	int m_Precision;
+	// grid vertices along y, a grid row is one x
+	int m_Columns;
+
+	// (3 * patchesX + 1) x (3 * patchesY + 1) control point heights, point (i, j) at [i * (3 * patchesY + 1) + j],
+	// patch (px, py) uses points 3 * px .. 3 * px + 3 and 3 * py .. 3 * py + 3
+	std::vector<float> m_ControlPoints;
+	float m_MaxHeight = 0.15f;
+	float m_Time = 0.f;
+
+	ThreadPool* m_ThreadPool;
+	// per vertex height and its x, y derivatives, uploaded every tick
+	std::vector<float> m_HeightSlope;
+	VertexBuffer* m_DynamicVB = nullptr;
+	VertexBufferLayout* m_DynamicVBL = nullptr;
+
+public:
+	// precision - grid quads along a patch side
+	// strips - drawn as triangle strips joined by the restart index instead of a triangle list, a third of the indices
+	BezierTerrain(int patchesX, int patchesY, int precision = 16, bool strips = true);
+	~BezierTerrain();
+
+	// Moves control points and retessellates the whole surface
+	void Tick(float interval);
+
+	// x in [0, patchesX], y in [0, patchesY], evaluated directly from the control points
+	float CalZ(float x, float y) const;
+
+	// Recalculates heights and slopes of all vertices by forward differencing, CPU side only
+	void Tessellate();
+	// pool used by Tessellate, nullptr - always single threaded
+	void SetThreadPool(ThreadPool* pool) { m_ThreadPool = pool; };
+
+	int GetPatchesX() const { return m_PatchesX; };
+	int GetPatchesY() const { return m_PatchesY; };
+	uint GetVertexCount() const { return m_HeightSlope.size() / BEZIER_VERTEX_SIZE; };
+
+private:
+	// animates every control point, then restores C1 continuity on the seams
+	void UpdateControlPoints();
+	// every patch lies in the convex hull of its control points, so the surface is between the lowest and highest one
+	void UpdateBounds();
+	void TessellatePatch(int px, int py);
+	float GetControlPoint(int i, int j) const { return m_ControlPoints[i * (3 * m_PatchesY + 1) + j]; };
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "Shader.h"
 #include "Renderer.h"
+#include "Frustum.h"
 
 #include "glm/glm.hpp"
 #include <GLFW/glfw3.h>
@@ -18,6 +19,8 @@ private:
 	glm::vec3 m_Orientation = glm::vec3(0.0f, -0.2f, -1.0f);
 	glm::vec3 m_Up = glm::vec3(0.0f, 1.0f, 0.0f); // Global Up
 	glm::mat4 m_CameraMatrix = glm::mat4(1.0f);
+	// planes of m_CameraMatrix in world space
+	Frustum m_Frustum;
 
 	int m_WindowWidth;
 	int m_WindowHeight;
@@ -60,6 +63,8 @@ public:
 	void Inputs(GLFWwindow* window, Shader& shader);
 
 	void SetFOVdeg(float FOVdeg) { m_FOVdeg = FOVdeg; };
+	// vertical field of view as passed to glm::perspective (radians)
+	float GetFOVdeg() const { return m_FOVdeg; };
 	float GetSpeed() { return m_Speed; }
 	float GetSensitivity() { return m_Sensitivity; }
 
@@ -68,6 +73,13 @@ public:
 
 	glm::vec3 GetOrientation() const { return m_Orientation; }
 
+	// projection * view, as of the last UpdateUniform
+	glm::mat4 GetCameraMatrix() const { return m_CameraMatrix; }
+	// what GetCameraMatrix() shows, models outside of it are culled
+	const Frustum& GetFrustum() const { return m_Frustum; }
+	int GetWindowHeight() const { return m_WindowHeight; }
+	float GetNearPlane() const { return m_NearPlane; }
+
 	// sets scroll reaction
 	static void SetScrollInput(GLFWwindow* window, bool value = true);
 
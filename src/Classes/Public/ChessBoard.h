@@ -7,6 +7,20 @@
 #include "../../enums/ObjectType.h"
 #define SIZE 8
 
+class RenderQueue;
+class OcclusionQueries;
+
+// Pieces of one type on any number of boards, drawn in one call at the finest level any of them on screen needs
+struct PieceGroup
+{
+    // MESH_MAX_LODS - no piece on screen yet
+    uint Lod = MESH_MAX_LODS;
+    std::vector<MeshInstance> Instances;
+};
+
+// key - piece type
+typedef std::map<int, PieceGroup> PieceInstances;
+
 class ChessBoard :
     public Model
 {
@@ -17,20 +31,57 @@ private:
     // first - type
     // second - colour (0 - white, 1 - black) 
     std::pair<int, bool> m_Board[SIZE][SIZE] = { std::pair<int, bool>(None, 0) };
+    // level of detail of every square's piece, piece models are shared by all squares
+    mutable uint m_PieceLods[SIZE][SIZE] = {};
+    // matrix and colour of every square's piece as of the last AddPieceInstances
+    mutable MeshInstance m_PieceInstances[SIZE][SIZE];
 
     glm::vec3 m_A1Position;
 
+    // shader for the board itself when the surface is evaluated on the GPU, nullptr - same shader as pieces
+    std::shared_ptr<Shader> m_SurfaceShader;
+    // INSTANCED variant the pieces are drawn with, nullptr - pieces aren't submitted by Submit
+    std::shared_ptr<Shader> m_PieceShader;
+    // one query per square, nullptr - every piece is drawn with the instanced groups
+    std::shared_ptr<OcclusionQueries> m_Occlusion;
+    // squares (row * SIZE + column) whose pieces were hidden last frame, left out of the groups for DrawOcclusionPass
+    mutable std::vector<int> m_OccludedSquares;
+
+    // groups of Submit, kept between frames so their storage is reused
+    static PieceInstances s_PieceInstances;
+
 public:
     static std::map<int, std::shared_ptr<Model>> piecesModelsMap;
     
     ChessBoard(std::shared_ptr<Mesh> Mesh, std::shared_ptr<Texture> Tex, glm::vec3 pos);
     ~ChessBoard();
 
+    // surface height (mesh space) and world space normal at the centre of square (row i, column j), exact, updated by Tick
     float GetZ(int i, int j) const;
+    glm::vec3 GetNormal(int i, int j) const;
     void Tick(float interval);
 
     void AddPiece(int type, bool colour, int row, int column);
 
-    void Draw(const Renderer& renderer, Shader& shader) const;
+    void SetSurfaceShader(std::shared_ptr<Shader> shader) { m_SurfaceShader = shader; };
+    void SetPieceShader(std::shared_ptr<Shader> shader) { m_PieceShader = shader; };
+    void SetOcclusionQueries(std::shared_ptr<OcclusionQueries> occlusion) { m_Occlusion = occlusion; };
+
+    // Adds every piece on the board to the group of its type, many boards can fill the same instances.
+    // With occlusion queries, pieces whose box was hidden last frame are kept for DrawOcclusionPass instead.
+    void AddPieceInstances(PieceInstances& instances) const;
+    // One instanced packet per non-empty group, at most one per piece type; the groups are emptied (their storage is kept
+    // for the next frame)
+    static void SubmitPieces(PieceInstances& instances, Shader& instancedShader, RenderQueue& queue);
+
+    // surface control points and, in BM_Tessellation mode, the camera position on top of the model's uniforms
+    void SetUniforms(Shader& shader, bool modelMatrix) const override;
+    // surface (with shader when there is no surface shader) and pieces
+    void Submit(RenderQueue& queue, Shader& shader) const;
+    // After the queue is flushed: tests the box of every piece on screen against the depth of the frame and draws the
+    // pieces held back by AddPieceInstances, each skipped by the GPU when its box is still hidden
+    void DrawOcclusionPass() const;
+    // pieces held back this frame and drawn conditionally
+    uint GetOccludedPieces() const { return m_OccludedSquares.size(); };
 };
 
@@ -0,0 +1,14 @@
+#pragma once
+
+// Stops in the debugger, the program can be continued from there
+#if defined(_MSC_VER)
+#define DEBUG_BREAK() __debugbreak()
+#elif defined(__GNUC__) || defined(__clang__)
+#include <csignal>
+#define DEBUG_BREAK() std::raise(SIGTRAP)
+#else
+#include <cstdlib>
+#define DEBUG_BREAK() std::abort()
+#endif
+
+#define ASSERT(x) if(!(x)) DEBUG_BREAK();
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+// Planes of a view frustum as (normal, distance), normals pointing inside and of unit length
+class Frustum
+{
+private:
+	// left, right, bottom, top, near, far
+	glm::vec4 m_Planes[6];
+
+public:
+	// everything is inside
+	Frustum();
+	// planes of the clip volume of cameraMatrix (projection * view), in the space the matrix transforms from
+	Frustum(const glm::mat4& cameraMatrix);
+
+	// false only when the sphere is entirely outside of a plane
+	bool IntersectsSphere(glm::vec3 centre, float radius) const;
+	// the same for the axis aligned box centre +- extent
+	bool IntersectsBox(glm::vec3 centre, glm::vec3 extent) const;
+
+	const glm::vec4& GetPlane(int i) const { return m_Planes[i]; };
+};
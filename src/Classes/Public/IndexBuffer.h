@@ -1,19 +1,44 @@
 #pragma once
 
+#include <GL/glew.h>
+#include <vector>
 #include "Typedef.h"
 
+// index that ends a triangle strip and starts the next one, stored as 0xFFFF in 16-bit buffers
+#define INDEX_RESTART 0xFFFFFFFF
+
 class IndexBuffer
 {
 private:
 	uint m_Renderer_ID;
 	uint m_Count;
+	// GL_UNSIGNED_SHORT when every index fits, GL_UNSIGNED_INT otherwise
+	uint m_Type;
+	// GL_TRIANGLES, GL_TRIANGLE_STRIP (strips joined with INDEX_RESTART) or GL_PATCHES
+	uint m_Mode;
 public:
-	IndexBuffer(const uint* data, uint count);
+	IndexBuffer(const uint* data, uint count, uint mode = GL_TRIANGLES);
+	// indices already in type (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT), uploaded as they are without a pass over them
+	IndexBuffer(const void* data, uint count, uint type, uint mode);
 	~IndexBuffer();
 
+	// Replaces all indices, count may differ from the previous one
+	void Update(const uint* data, uint count);
+
 	void Bind() const;
 	void UnBind() const;
 
 	uint GetCount() const { return m_Count; };
-};
+	uint GetType() const { return m_Type; };
+	uint GetMode() const { return m_Mode; };
+	// bytes of one index of type
+	static uint GetTypeSize(uint type) { return type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(uint); };
+	// restart index in the stored type
+	uint GetRestartIndex() const { return m_Type == GL_UNSIGNED_SHORT ? 0xFFFF : INDEX_RESTART; };
 
+	// Indices read back from the buffer as uint, INDEX_RESTART kept, slow - for statistics only
+	std::vector<uint> ReadIndices() const;
+
+private:
+	void Upload(const uint* data, uint count, uint usage);
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include "Typedef.h"
+
+// Read only view of a whole file mapped into memory, pages are loaded by the OS when first touched.
+// Unmapped in the destructor, GetData() is nullptr when the file couldn't be opened or is empty.
+class MappedFile
+{
+private:
+	const uchar* m_Data = nullptr;
+	size_t m_Size = 0;
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#else
+	int m_File = -1;
+#endif
+
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uchar* GetData() const { return m_Data; };
+	size_t GetSize() const { return m_Size; };
+};
@@ -2,37 +2,160 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include "Shader.h"
 #include "Typedef.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <assimp/scene.h>
 #include "IndexBuffer.h"
+#include "MappedFile.h"
+#include "VertexBufferLayout.h"
 
 class VertexArray;
 class VertexBuffer;
-class VertexBufferLayout;
+struct MeshOptimizeStats;
+
+// levels of detail of imported meshes, the finest included
+#define MESH_MAX_LODS 4
+
+// One level of detail, a range of the mesh index buffer over the shared vertices
+struct MeshLod
+{
+	uint FirstIndex;
+	uint IndexCount;
+	// largest distance from the full detail surface, mesh units
+	float Error;
+};
+
+// Part of a mesh with its own material, drawn from the shared buffers with its indices relative to BaseVertex
+struct SubMesh
+{
+	uint BaseVertex;
+	uint VertexCount;
+	// material index in the source scene
+	uint Material;
+	uint LodCount;
+	// finest first
+	MeshLod Lods[MESH_MAX_LODS];
+};
+
+// Per-instance attributes of Mesh::DrawInstanced, read by the INSTANCED variant of Phong.shader
+struct MeshInstance
+{
+	glm::mat4 Model;
+	glm::vec4 Color;
+};
+
+// CPU side of a mesh file, filled by Mesh::LoadData without any GL calls and turned into buffers by Mesh(const MeshData&)
+struct MeshData
+{
+	// cache the pointers below point into, nullptr when the source was imported
+	std::unique_ptr<MappedFile> Cache;
+	std::vector<float> ImportedVertices;
+	std::vector<uint> ImportedIndices;
+	// ImportedIndices in 16 bits when every one fits
+	std::vector<ushort> ImportedShortIndices;
+	// ImportedVertices packed when Quantized
+	std::vector<uchar> QuantizedVertices;
+
+	// interleaved as described by Layout
+	const void* Vertices = nullptr;
+	uint VertexCount = 0;
+	// of IndexType, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	const void* Indices = nullptr;
+	uint IndexCount = 0;
+	uint IndexType = GL_UNSIGNED_INT;
+	// parts of the mesh, empty - all indices are one part of one level
+	std::vector<SubMesh> SubMeshes;
+	VertexBufferLayout Layout;
+	// 16-bit positions relative to the bounds and octahedral normals, see Mesh::SetDecodeUniforms
+	bool Quantized = false;
+	glm::vec3 BoundsMin = glm::vec3(0.f);
+	glm::vec3 BoundsMax = glm::vec3(0.f);
+	glm::vec3 BoundingCentre = glm::vec3(0.f);
+	float BoundingRadius = 0.f;
+};
 
 class Mesh
 {
 protected:
-	VertexArray* m_VA;
-	VertexBufferLayout* m_VBL;
-	VertexBuffer* m_VB;
-	IndexBuffer* m_IB;
-private:
+	VertexArray* m_VA = nullptr;
+	VertexBufferLayout* m_VBL = nullptr;
+	VertexBuffer* m_VB = nullptr;
+	IndexBuffer* m_IB = nullptr;
+	// axis aligned bounds of the positions in mesh space, set by the import (or its cache)
+	glm::vec3 m_BoundsMin = glm::vec3(0.f);
+	glm::vec3 m_BoundsMax = glm::vec3(0.f);
+	// sphere around the same positions, radius 0 - no bounds, never culled
+	glm::vec3 m_BoundingCentre = glm::vec3(0.f);
+	float m_BoundingRadius = 0.f;
+	bool m_Quantized = false;
+	std::vector<SubMesh> m_SubMeshes;
+	// MeshInstance stream after the vertex attributes, made by the first DrawInstanced
+	mutable VertexBuffer* m_InstanceVB = nullptr;
 
-	void LoadMesh(const std::string& path);
-	void ProcessNode(aiNode* node, const aiScene* scene);
-	void ProcessMesh(aiMesh* mesh);
+	// indices drawn by all meshes since the last ResetDrawnIndices
+	static uint s_DrawnIndices;
+
+	// box and the sphere around it, for generated surfaces that know only their extent (e.g. a control point hull)
+	void SetBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+private:
+	// every mesh of every node becomes a SubMesh of data, stats get the sums of all of them
+	static void ProcessNode(aiNode* node, const aiScene* scene, MeshData& data, MeshOptimizeStats& stats);
+	static void ProcessMesh(aiMesh* mesh, MeshData& data, MeshOptimizeStats& stats);
+	void CreateBuffers(const MeshData& data);
+	// appends coarser levels of detail of the indices to them, lods gets all levels
+	static void BuildLods(const std::vector<float>& vertices, std::vector<uint>& indices, std::vector<MeshLod>& lods);
+	// sourceHash 0 - source missing, any cache of the current version is used
+	static bool LoadCache(const std::string& cachePath, unsigned long long sourceHash, MeshData& data);
+	static void WriteCache(const std::string& cachePath, unsigned long long sourceHash, const MeshData& data);
+	// instanceCount 0 - plain draw calls
+	void DrawElements(uint level, uint instanceCount) const;
 public:
+	// Imports store 16 bytes per vertex instead of 32, drawn with the QUANTIZED_MESH variant of Phong.shader.
+	// Set before loading, caches made with the other setting are imported again.
+	static bool s_QuantizeImport;
+
 	Mesh() { }
 	Mesh(const std::string& path);
-	~Mesh();
+	// buffers from data made by LoadData, on the thread owning the GL context
+	Mesh(const MeshData& data);
+	virtual ~Mesh();
+
+	// Loads path + ".meshcache" when it was made from the same source, otherwise imports path with assimp and writes it.
+	// Makes no GL calls, so it can run on any thread. False when the file couldn't be imported.
+	static bool LoadData(const std::string& path, MeshData& data);
 
 	void Bind() const;
 	void UnBind() const;
+	// draw call for the whole mesh (its finest level), has to be bound
+	virtual void Draw() const;
+	// level - 0 finest .. GetLodCount() - 1, every submesh draws its own level or its coarsest one
+	void DrawLod(uint level) const;
+	// one draw call (per submesh) of count copies of level, has to be bound; the instances are uploaded to a stream buffer
+	void DrawInstanced(uint level, const MeshInstance* instances, uint count) const;
+	// position decoding of quantized meshes: position = u_PositionOffset + quantized * u_PositionScale,
+	// meshes with float positions set nothing and keep the shader defaults
+	void SetDecodeUniforms(Shader& shader) const;
 
+	// vertex array name, identifies the mesh's GL state
+	uint GetId() const;
 	uint GetIndexCount() const { return m_IB->GetCount(); };
+	const IndexBuffer& GetIndexBuffer() const { return *m_IB; };
+	const glm::vec3& GetBoundsMin() const { return m_BoundsMin; };
+	const glm::vec3& GetBoundsMax() const { return m_BoundsMax; };
+	const glm::vec3& GetBoundingCentre() const { return m_BoundingCentre; };
+	float GetBoundingRadius() const { return m_BoundingRadius; };
+	bool HasBounds() const { return m_BoundingRadius > 0.f; };
+	bool IsQuantized() const { return m_Quantized; };
+	uint GetLodCount() const;
+	// largest error of the submeshes at level, 0 for meshes without levels
+	float GetLodError(uint level) const;
+	uint GetSubMeshCount() const { return m_SubMeshes.size(); };
+	const SubMesh& GetSubMesh(uint i) const { return m_SubMeshes[i]; };
+
+	static void ResetDrawnIndices() { s_DrawnIndices = 0; };
+	static uint GetDrawnIndices() { return s_DrawnIndices; };
 };
 
 
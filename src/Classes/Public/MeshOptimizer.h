@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include "Typedef.h"
+#include "IndexBuffer.h"
+
+// FIFO post-transform vertex cache size the statistics below assume, small enough for any GPU
+#define MESH_VERTEX_CACHE_SIZE 32
+// grid quads walked down a column before the next column, both vertex columns of a band have to fit in the cache
+// or every vertex misses twice (the first column evicts the second one)
+#define MESH_GRID_BAND (MESH_VERTEX_CACHE_SIZE / 2 - 2)
+
+// Average cache miss ratio - vertex shader runs per triangle with a FIFO cache of cacheSize vertices.
+// mode GL_TRIANGLES or GL_TRIANGLE_STRIP (with INDEX_RESTART), 3 means no reuse, a large grid can get close to 0.5
+float CalculateACMR(const std::vector<uint>& indices, uint mode, uint cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+// Triangles of a rows x columns vertex grid, vertex (i, j) at i * columns + j, quad split along (i, j + 1) - (i + 1, j).
+// Grid is walked in bands of band rows: inside a band column by column, each column top to bottom.
+// strips - one GL_TRIANGLE_STRIP per band column, joined with INDEX_RESTART, otherwise GL_TRIANGLES
+std::vector<uint> BuildGridIndices(int rows, int columns, bool strips, int band = MESH_GRID_BAND);
+
+// ACMR may grow by this factor when OptimizeOverdraw reorders clusters, otherwise the cache order is kept
+#define MESH_OVERDRAW_THRESHOLD 1.05f
+
+// Before and after numbers of OptimizeMesh
+struct MeshOptimizeStats
+{
+	uint VerticesBefore = 0;
+	uint VerticesAfter = 0;
+	uint TrianglesBefore = 0;
+	uint TrianglesAfter = 0;
+	float ACMRBefore = 0.f;
+	float ACMRAfter = 0.f;
+	// clusters OptimizeOverdraw sorted, 0 when it kept the cache order
+	uint OverdrawClusters = 0;
+};
+
+// Merges vertices whose vertexSize floats are all the same, drops triangles that become degenerate.
+// vertices are compacted in place, indices remapped (GL_TRIANGLES).
+void WeldVertices(std::vector<float>& vertices, std::vector<uint>& indices, uint vertexSize);
+
+// Tipsify triangle order (Sander, Nehab, Barczak 2007) for a FIFO cache of cacheSize vertices: fans around a vertex
+// still in the cache, next vertex picked by how long it stays cached. clusters - gets the first triangle of every run
+// that starts with a cold cache, runs can be reordered without losing much of the cache hit rate.
+std::vector<uint> OptimizeVertexCache(const std::vector<uint>& indices, uint vertexCount, uint cacheSize = MESH_VERTEX_CACHE_SIZE,
+	std::vector<uint>* clusters = nullptr);
+
+// Sorts clusters from OptimizeVertexCache so the ones facing away from the mesh centre, usually in front, are drawn first
+// and hide more of the rest with the depth test. Positions are the first 3 floats of a vertex. Keeps the order when ACMR
+// would grow above threshold times the current one, returns whether it reordered.
+bool OptimizeOverdraw(std::vector<uint>& indices, const std::vector<uint>& clusters, const std::vector<float>& vertices, uint vertexSize,
+	float threshold = MESH_OVERDRAW_THRESHOLD);
+
+// Renumbers vertices in order of their first use so vertex fetch walks the buffer forward, unused vertices are dropped
+void OptimizeVertexFetch(std::vector<float>& vertices, std::vector<uint>& indices, uint vertexSize);
+
+// All of the above in order: weld, cache, overdraw, fetch
+MeshOptimizeStats OptimizeMesh(std::vector<float>& vertices, std::vector<uint>& indices, uint vertexSize);
+
+// copies of a position whose other floats (texture coordinate, normal) differ more than this aren't merged by
+// SimplifyMesh, the triangles of one would be stretched over the other's texture or lit from the wrong side
+#define MESH_SIMPLIFY_MAX_ATTRIBUTE_DISTANCE 0.5f
+
+// Quadric error edge collapse (Garland, Heckbert 1997) that only moves a vertex onto a neighbour, so the result indexes
+// the same vertex buffer as the source. Copies of one position (texture or normal seams, flat shading) move together,
+// each onto the copy of the target it shares an edge with or the one with the closest attributes, which keeps seams
+// closed; vertices on open borders stay in place. Positions are the first 3 floats of a vertex.
+// Stops at targetIndexCount or when nothing more can collapse. error - largest distance, in mesh units, of a source
+// vertex from the result (measured against the result's triangles around the vertex it was merged into)
+std::vector<uint> SimplifyMesh(const std::vector<uint>& indices, const std::vector<float>& vertices, uint vertexSize, uint targetIndexCount,
+	float* error = nullptr);
@@ -7,9 +7,16 @@
 #include "IndexBuffer.h"
 #include "Texture.h"
 #include "Mesh.h"
+#include "Frustum.h"
 #include "memory"
 #include "../../enums/ObjectType.h"
 
+// largest error of a level of detail on screen, pixels
+#define MODEL_LOD_PIXEL_ERROR 1.f
+// a coarser level is taken only when its error is below this part of MODEL_LOD_PIXEL_ERROR,
+// so a model standing at a level boundary doesn't switch back and forth
+#define MODEL_LOD_HYSTERESIS 0.5f
+
 class Model
 {
 protected:
@@ -21,7 +28,11 @@ private:
 	glm::vec3 m_Position;
 	glm::vec3 m_Rotation;
 	glm::vec3 m_Scale;
+	// model's y axis is turned to this direction, e.g. to stand on a slope
+	glm::vec3 m_Up;
 
+	// level of detail of the last Draw(shader), kept for the hysteresis
+	mutable uint m_Lod = 0;
 
 public:
 	static std::map<int, std::shared_ptr<Mesh>> meshMap;
@@ -30,10 +41,38 @@ public:
 	~Model();
 
 	std::shared_ptr<Mesh> GetMesh() const { return m_Mesh; };
+	std::shared_ptr<Texture> GetTexture() const { return m_Texture; };
 	void Bind() const;
 	void UnBind() const;
 
+	// Per draw uniforms of the model, shader has to be bound. modelMatrix - false for instanced draws,
+	// where every instance brings its own
+	virtual void SetUniforms(Shader& shader, bool modelMatrix) const;
+
 	virtual void Draw(Shader& shader) const;
+	// lod - level drawn last time by the caller, updated; for a model drawn at several places (one state per place)
+	void Draw(Shader& shader, uint& lod) const;
+	// every instance at level lod in one draw call, shader - INSTANCED variant, model matrix and colour come from instances
+	void DrawInstanced(Shader& shader, uint lod, const std::vector<MeshInstance>& instances) const;
+
+	// Level of detail of the mesh for the current camera: the coarsest whose error stays under MODEL_LOD_PIXEL_ERROR
+	// pixels, levels coarser than current need the MODEL_LOD_HYSTERESIS margin
+	uint SelectLod(uint current) const;
+	// the same for this model drawn with modelMatrix
+	uint SelectLod(uint current, const glm::mat4& modelMatrix) const;
+	// SelectLod from the level of the last call (or Draw(shader)), kept for the next one
+	uint UpdateLod() const { m_Lod = SelectLod(m_Lod); return m_Lod; };
+
+	// Mesh bounds moved to world space and tested against frustum: the sphere first, the box around the transformed
+	// box only for spheres crossing a plane. Meshes without bounds are always visible.
+	bool IsVisible(const Frustum& frustum) const;
+	// the same for this model drawn with modelMatrix
+	bool IsVisible(const Frustum& frustum, const glm::mat4& modelMatrix) const;
+
+	// translate * scale * rotation, as sent to u_Model
+	glm::mat4 GetModelMatrix() const;
+	// the same with the model moved to position and stood along up, e.g. for one of many instances
+	glm::mat4 GetModelMatrix(glm::vec3 position, glm::vec3 up) const;
 
 	void RotateX(float angle);
 	void RotateY(float angle);
@@ -41,6 +80,10 @@ public:
 
 	void SetScale(glm::vec3);
 	void SetScale(float);
+	glm::vec3 GetScale() const { return m_Scale; };
+
+	// up - unit vector, (0, 1, 0) - upright
+	void SetUp(glm::vec3 up) { m_Up = up; };
 
 	void SetPosition(glm::vec3 nPos) { m_Position = nPos; };
 	glm::vec3 GetPosition() const { return m_Position; };
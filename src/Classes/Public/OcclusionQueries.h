@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "Model.h"
+#include "memory"
+
+class VertexArray;
+class VertexBuffer;
+class VertexBufferLayout;
+
+// Hardware occlusion queries on the bounding boxes of models, one query object per id (e.g. a board square).
+// Boxes are tested against the depth of everything drawn before Begin. Results are read a frame later and only when
+// the GPU already has them, so the CPU never waits; until then the last known result stays.
+class OcclusionQueries
+{
+private:
+	struct Entry
+	{
+		uint Query = 0;
+		// issued and not read yet
+		bool Pending = false;
+		// no sample of the box passed the depth test when last read
+		bool Occluded = false;
+		// box tested since the last Begin, conditional draws of other ids aren't conditional
+		bool Issued = false;
+	};
+	std::vector<Entry> m_Entries;
+
+	// unit box [-1, 1]^3, scaled to the bounds of each model
+	VertexArray* m_BoxVA;
+	VertexBuffer* m_BoxVB;
+	VertexBufferLayout* m_BoxVBL;
+	IndexBuffer* m_BoxIB;
+	// flat shader with u_camMatrix and u_Model, e.g. Light.shader
+	std::shared_ptr<Shader> m_Shader;
+
+	// boxes tested since the last Begin
+	uint m_IssuedQueries = 0;
+
+	// reads the result of id when it is available
+	void Update(Entry& entry);
+
+public:
+	OcclusionQueries(uint count, std::shared_ptr<Shader> boxShader);
+	~OcclusionQueries();
+
+	// Last known result of id, false until a query of it finished
+	bool IsOccluded(uint id);
+	// forgets the result of id, e.g. when its model isn't on screen and so wasn't tested
+	void Reset(uint id);
+
+	// Depth only pass of the boxes with the current camera: colour and depth writes off until End
+	void Begin();
+	// box of model's mesh bounds drawn with modelMatrix, not tested (visible) when the camera is inside it
+	void Query(uint id, const Model& model, const glm::mat4& modelMatrix);
+	void End();
+
+	// draws until EndConditional are skipped by the GPU when the box of id wasn't visible in the last Begin - End,
+	// and done when the query hasn't finished yet, without waiting for it
+	void BeginConditional(uint id) const;
+	void EndConditional(uint id) const;
+
+	uint GetIssuedQueries() const { return m_IssuedQueries; };
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+#include "Model.h"
+#include "../../enums/RenderPass.h"
+
+// Sort key, most significant first: pass | shader | texture | mesh | depth.
+// Ids are GL object names cut to their bits, objects sharing the cut bits only lose grouping, never correctness.
+#define RENDER_KEY_PASS_BITS 4
+#define RENDER_KEY_SHADER_BITS 12
+#define RENDER_KEY_TEXTURE_BITS 12
+#define RENDER_KEY_MESH_BITS 12
+#define RENDER_KEY_DEPTH_BITS 24
+
+// One draw of a model, everything the queue needs to draw it after sorting
+struct DrawPacket
+{
+	const Model* DrawnModel;
+	Shader* DrawShader;
+	glm::vec4 Color;
+	uint Lod;
+	// range of the queue's instances, InstanceCount 0 - single draw with the model's own matrix
+	uint FirstInstance;
+	uint InstanceCount;
+};
+
+// Draws submitted during a frame, sorted by key in Flush so shader, texture and mesh changes are grouped
+// and opaque geometry goes front to back
+class RenderQueue
+{
+private:
+	std::vector<DrawPacket> m_Packets;
+	// key and packet index, sorted instead of the packets
+	std::vector<std::pair<unsigned long long, uint>> m_Keys;
+	std::vector<MeshInstance> m_Instances;
+
+	// packets and state changes of the last Flush
+	uint m_FlushedPackets = 0;
+	uint m_ShaderChanges = 0;
+	uint m_MeshChanges = 0;
+	uint m_TextureChanges = 0;
+	// models and instances outside of the camera frustum since the last Flush, and both counts of the last Flush
+	uint m_Culled = 0;
+	uint m_CulledObjects = 0;
+	uint m_DrawnObjects = 0;
+
+	void Add(const DrawPacket& packet, RenderPass pass, float depth);
+
+public:
+	// models have to live until Flush, level of detail is picked here for the current camera,
+	// models outside of its frustum are dropped
+	void Submit(const Model& model, Shader& shader, glm::vec4 color, RenderPass pass = RP_Opaque);
+	// visible instances are copied, shader - INSTANCED variant, sorted by the instance nearest to the camera
+	void SubmitInstanced(const Model& model, Shader& shader, uint lod, const std::vector<MeshInstance>& instances, RenderPass pass = RP_Opaque);
+
+	// Sorts and draws every packet, then empties the queue. Per frame uniforms (camera, lights) have to be set before.
+	void Flush();
+
+	static unsigned long long MakeKey(RenderPass pass, uint shader, uint texture, uint mesh, float depth);
+
+	uint GetFlushedPackets() const { return m_FlushedPackets; };
+	uint GetShaderChanges() const { return m_ShaderChanges; };
+	uint GetMeshChanges() const { return m_MeshChanges; };
+	uint GetTextureChanges() const { return m_TextureChanges; };
+	// an instance counts as one object
+	uint GetCulledObjects() const { return m_CulledObjects; };
+	uint GetDrawnObjects() const { return m_DrawnObjects; };
+};
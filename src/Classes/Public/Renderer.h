@@ -1,25 +1,102 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <unordered_map>
 #include "Shader.h"
+#include "Debug.h"
 
-#define ASSERT(x) if(!(x)) __debugbreak(); 
-#define GLCall(x) GLClearError();\
-	x;\
-	ASSERT(GLLogCall(#x, __FILE__, __LINE__))
+// Release builds make GLCall a plain call, errors are only reported by debug builds or with GL_CHECK_RELEASE defined.
+// Checked calls record their site for the KHR_debug callback (see GLInitDebugOutput), glGetError is only called
+// around the calls picked by the validation interval.
+#if defined(NDEBUG) && !defined(GL_CHECK_RELEASE)
+#define GL_CHECK_ENABLED 0
+#else
+#define GL_CHECK_ENABLED 1
+#endif
 
+#if !GL_CHECK_ENABLED
+#define GLCall(x) x
+#else
+#define GLCall(x) do { \
+	bool glValidate = GLBeginCall(#x, __FILE__, __LINE__); \
+	x; \
+	if (glValidate) { \
+		ASSERT(GLLogCall(#x, __FILE__, __LINE__)) \
+	} \
+	} while (0)
+#endif
+
+// validation interval used when the context has no debug output
+#define GL_VALIDATION_INTERVAL_NO_DEBUG_OUTPUT 1
 
 void GLClearError();
 bool GLLogCall(const char* function, const char* file, int line);
+// Remembers the call site for the debug callback, true (with the error queue cleared) when the call has to be validated
+bool GLBeginCall(const char* function, const char* file, int line);
+// Installs a synchronous KHR_debug callback that prints messages with the site of the GLCall they came from and
+// breaks on errors. False when the context has no debug output, every call is validated with glGetError then.
+bool GLInitDebugOutput();
+// 0 - only the debug callback, 1 - glGetError around every call, n - around one call in n
+void GLSetValidationInterval(uint interval);
 
 class Model;
 class VertexArray;
 class IndexBuffer;
 class Mesh;
 
+// texture units the state tracker remembers, binds to higher units are always issued
+#define RENDERER_TEXTURE_UNITS 16
+// tracked value that doesn't match any GL name, the next bind is always issued
+#define RENDERER_UNKNOWN_STATE 0xFFFFFFFF
+
 class Renderer
 {
+private:
+	// GL state as last set through the tracker below, the context starts with everything 0 and disabled
+	static uint s_Program;
+	static uint s_VertexArray;
+	// element buffer is part of the vertex array state, so it is kept per vertex array
+	static std::unordered_map<uint, uint> s_ElementBuffers;
+	static uint s_ActiveTextureUnit;
+	static uint s_Textures[RENDERER_TEXTURE_UNITS];
+	// glEnable / glDisable capabilities, missing - not known yet
+	static std::unordered_map<uint, bool> s_Capabilities;
+	static uint s_BlendSource;
+	static uint s_BlendDestination;
+	// depth and colour writes and the depth test, tracked from their GL defaults (writes on, GL_LESS)
+	static bool s_DepthMask;
+	static uint s_DepthFunc;
+	// bit 0 red ... bit 3 alpha
+	static uint s_ColorMask;
+
+	// GL calls issued and skipped by the tracker since the last ResetStateCounters
+	static uint s_StateCalls;
+	static uint s_SkippedStateCalls;
+
 public:
 	void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const;
 	void Clear() const;
+
+	// State tracker: every bind and enable goes through these, calls that wouldn't change anything are skipped
+	static void UseProgram(uint program);
+	static void BindVertexArray(uint vertexArray);
+	// binds to the current vertex array
+	static void BindElementBuffer(uint buffer);
+	// GL_TEXTURE_2D of unit
+	static void BindTexture(uint unit, uint texture);
+	static void SetEnabled(uint capability, bool enabled);
+	static void SetBlendFunc(uint source, uint destination);
+	static void SetDepthMask(bool write);
+	static void SetDepthFunc(uint func);
+	static void SetColorMask(bool red, bool green, bool blue, bool alpha);
+
+	// Deleted objects are forgotten, so a new object getting the same name is bound again
+	static void ForgetProgram(uint program);
+	static void ForgetVertexArray(uint vertexArray);
+	static void ForgetElementBuffer(uint buffer);
+	static void ForgetTexture(uint texture);
+
+	static uint GetStateCalls() { return s_StateCalls; };
+	static uint GetSkippedStateCalls() { return s_SkippedStateCalls; };
+	static void ResetStateCounters() { s_StateCalls = 0; s_SkippedStateCalls = 0; };
 };
\ No newline at end of file
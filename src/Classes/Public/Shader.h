@@ -3,12 +3,16 @@
 #include <iostream>
 #include "Typedef.h"
 #include <unordered_map>
+#include <vector>
 #include "glm/glm.hpp"
 
 struct ShaderSource
 {
 	std::string VertexSource;
 	std::string FragmentSource;
+	// empty when the file (or the variant) has no tessellation stages
+	std::string TessControlSource;
+	std::string TessEvaluationSource;
 };
 
 class Shader
@@ -17,30 +21,38 @@ private:
 
 	uint m_Renderer_Id;
 	std::string m_Filepath;
+	std::vector<std::string> m_Defines;
+	std::vector<std::string> m_FeedbackVaryings;
 	std::unordered_map<std::string, int> m_LocationCache;
 
 public:
 	static std::shared_ptr<Shader> m_CurrShader;
 
-	Shader(const std::string& filepath);
+	// defines - names added as #define after the #version line of every stage, used to build variants of one shader file
+	// feedbackVaryings - vertex outputs captured (interleaved) with transform feedback, the file may then have no fragment stage
+	Shader(const std::string& filepath, const std::vector<std::string>& defines = {}, const std::vector<std::string>& feedbackVaryings = {});
 	~Shader();
 
 	void Bind() const;
 	void UnBind() const;
+	uint GetId() const { return m_Renderer_Id; };
 
 
 	// Set uniforms
 	void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
 	void SetUniform3f(const std::string& name, float v0, float v1, float v2);
 	void SetUniform3f(const std::string& name, glm::vec3 vec);
+	void SetUniform4fv(const std::string& name, int count, const float* values);
+	void SetUniform1fv(const std::string& name, int count, const float* values);
 
 	void SetUniformMatrix4f(const std::string& name, glm::mat4& matrix);
 	void SetUniformMatrix4fv(const std::string& name, const glm::f32* pointer);
 	void SetUniform1i(const std::string& name, int value);
+	void SetUniform1f(const std::string& name, float value);
 
 private:
-	uint CompileShader(uint type, const std::string& source);
-	uint CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
+	uint CompileShader(uint type, std::string source);
+	uint CreateShader(const ShaderSource& source);
 	ShaderSource ParseShader(const std::string& file);
 	int GetUniformLocation(const std::string& name);
 };
@@ -4,6 +4,20 @@
 #include "Renderer.h"
 #include <string>
 
+// Decoded RGBA8 pixels, filled by Texture::Decode without any GL calls and uploaded by Texture(TextureData&)
+struct TextureData
+{
+	std::string FilePath;
+	uchar* Pixels = nullptr;
+	int Width = 0, Height = 0, BPP = 0;
+
+	TextureData() { }
+	~TextureData();
+
+	TextureData(const TextureData&) = delete;
+	TextureData& operator=(const TextureData&) = delete;
+};
+
 class Texture
 {
 private:
@@ -12,13 +26,21 @@ private:
 	uchar* m_LocalBuffer;
 	int m_Width, m_Height, m_BPP;
 
+	void Create(const TextureData& data);
+
 public:
 	Texture(const std::string& path);
+	// texture from pixels decoded by Decode, on the thread owning the GL context
+	Texture(const TextureData& data);
 	~Texture();
 
+	// Decodes the image with stb_image, flipped for GL. Makes no GL calls, so it can run on any thread.
+	static bool Decode(const std::string& path, TextureData& data);
+
 	void Bind(uint slot = 0) const;
 	void UnBind() const;
 
+	inline uint GetId() const { return m_RendererID; };
 	inline int GetWidth() const { return m_Width; };
 	inline int GetHeight() const { return m_Height; };
 
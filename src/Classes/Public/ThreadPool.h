@@ -0,0 +1,64 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include "Typedef.h"
+
+// Persistent worker threads for splitting per-frame work (e.g. tessellation rows) into bands.
+// Threads are created once in the constructor, ParallelFor neither creates threads nor allocates.
+class ThreadPool
+{
+public:
+	typedef void (*Job)(void* context, int band);
+
+private:
+	std::vector<std::thread> m_Workers;
+
+	// a ParallelFor has the workers, callers on other threads meanwhile run their bands themselves
+	std::atomic<bool> m_Busy;
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_WorkDone;
+
+	// current job, changed only under m_Mutex while no worker is running bands
+	Job m_Job = nullptr;
+	void* m_Context = nullptr;
+	int m_BandCount = 0;
+	uint m_Generation = 0;
+	bool m_Stop = false;
+
+	std::atomic<int> m_NextBand;
+	std::atomic<int> m_BandsLeft;
+	// workers that took the current job and haven't left it yet
+	int m_ActiveWorkers = 0;
+
+public:
+	// threadCount - threads working on a job including the one calling ParallelFor,
+	// 0 - one per hardware thread
+	ThreadPool(uint threadCount = 0);
+	~ThreadPool();
+
+	// Calls job(context, band) for every band in [0, bandCount) on the workers and the calling thread,
+	// returns when all bands are finished. Calls from different threads never wait for each other:
+	// while one has the workers, the others run all their bands on their own thread.
+	void ParallelFor(int bandCount, Job job, void* context);
+
+	// func(band) - func is only referenced, so a lambda with captures doesn't allocate
+	template<typename F>
+	void ParallelFor(int bandCount, F& func)
+	{
+		ParallelFor(bandCount, [](void* context, int band) { (*(F*)context)(band); }, &func);
+	}
+
+	uint GetThreadCount() const { return (uint)m_Workers.size() + 1; };
+
+	// pool shared by everything that doesn't get its own, created on first use
+	static ThreadPool& GetShared();
+
+private:
+	void WorkerLoop();
+	void RunBands(Job job, void* context, int bandCount);
+};
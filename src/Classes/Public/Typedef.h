@@ -1,3 +1,3 @@
-
 typedef unsigned int uint;
+typedef unsigned short ushort;
 typedef unsigned char uchar;
\ No newline at end of file
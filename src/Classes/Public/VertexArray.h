@@ -7,12 +7,18 @@ class VertexArray
 private:
 
 	uint m_Renderer_Id;
+	// attributes already taken by earlier buffers, the next AddBuffer continues from here
+	uint m_AttribCount;
 
 public:
 	VertexArray();
 	~VertexArray();
 
-	void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layouot);
+	// Adds attributes of layout read from vb, after the attributes of buffers added before,
+	// so static and streamed data can live in separate buffers of one VAO.
+	// divisor - 0 per vertex, n - next element every n instances of an instanced draw
+	void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layouot, uint divisor = 0);
 	void Bind() const;
 	void UnBind() const;
+	uint GetId() const { return m_Renderer_Id; };
 };
\ No newline at end of file
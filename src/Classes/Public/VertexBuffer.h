@@ -1,16 +1,35 @@
 #pragma once
+#include <GL/glew.h>
 #include "Typedef.h"
 
 class VertexBuffer
 {
 private:
 	uint m_Renderer_ID;
+	uint m_Size;
+	uint m_Usage;
+
+	// bytes sent to the GPU by all vertex buffers since the last ResetUploadedBytes
+	static uint s_UploadedBytes;
 public:
-	VertexBuffer(const void* data, uint size);
+	// usage - GL_STATIC_DRAW for data uploaded once, GL_STREAM_DRAW / GL_DYNAMIC_DRAW for data changed with Update
+	VertexBuffer(const void* data, uint size, uint usage = GL_STATIC_DRAW);
 	~VertexBuffer();
 
+	// Replaces size bytes at offset in place, the buffer object and every VertexArray using it stay valid.
+	// Writing from offset 0 replaces the contents: the old storage is orphaned first, so the driver doesn't wait
+	// for draws still reading it, and anything past size is undefined afterwards.
+	void Update(const void* data, uint size, uint offset = 0);
+	// Grows the storage to size bytes when it is smaller, the contents are lost but the buffer object stays the same
+	void Reserve(uint size);
+
 	void Bind() const;
 	void UnBind() const;
+	// binds as transform feedback output index, the next feedback pass writes into this buffer
+	void BindFeedback(uint index) const;
 
-};
+	uint GetSize() const { return m_Size; };
 
+	static uint GetUploadedBytes() { return s_UploadedBytes; };
+	static void ResetUploadedBytes() { s_UploadedBytes = 0; };
+};
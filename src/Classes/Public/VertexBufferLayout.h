@@ -2,8 +2,14 @@
 #include <vector>
 #include "Typedef.h"
 #include <GL/glew.h>
+#include "Debug.h"
 
-#define TEMPASSERT(x) if(!x) __debugbreak()
+#define TEMPASSERT(x) if(!(x)) DEBUG_BREAK()
+
+// 16-bit float, bits as made by glm::packHalf1x16
+struct half { ushort bits; };
+// signed normalized x, y, z in 10 bits each and w in 2 bits of one uint (GL_INT_2_10_10_10_REV)
+struct int2_10_10_10 { uint bits; };
 
 struct VertexElement
 {
@@ -21,10 +27,26 @@ struct VertexElement
 			return 4;
 		case GL_UNSIGNED_BYTE: 
 			return 1;
+		case GL_HALF_FLOAT:
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		// all four components
+		case GL_INT_2_10_10_10_REV:
+			return 4;
 		default:
 			TEMPASSERT(false);
+			return 0;
 		}
 	}
+
+	// bytes of the whole attribute
+	uint GetSize() const
+	{
+		if (type == GL_INT_2_10_10_10_REV)
+			return GetSizeOfType(type);
+		return count * GetSizeOfType(type);
+	}
 };
 
 class VertexBufferLayout
@@ -34,7 +56,7 @@ private:
 	uint m_Stride;
 
 public:
-	VertexBufferLayout() {};
+	VertexBufferLayout() : m_Stride(0) {};
 
 	template<typename T>
 	void Push(uint count)
@@ -62,6 +84,40 @@ public:
 		m_Elements.push_back(VertexElement{ GL_UNSIGNED_BYTE, count, GL_TRUE });
 		m_Stride += count * VertexElement::GetSizeOfType(GL_UNSIGNED_BYTE);
 	}
+
+	// [0, 1]
+	template<>
+	void Push<ushort>(uint count)
+	{
+		PushElement(VertexElement{ GL_UNSIGNED_SHORT, count, GL_TRUE });
+	}
+
+	// [-1, 1]
+	template<>
+	void Push<short>(uint count)
+	{
+		PushElement(VertexElement{ GL_SHORT, count, GL_TRUE });
+	}
+
+	template<>
+	void Push<half>(uint count)
+	{
+		PushElement(VertexElement{ GL_HALF_FLOAT, count, GL_FALSE });
+	}
+
+	// count has to be 4, the shader sees [-1, 1] components
+	template<>
+	void Push<int2_10_10_10>(uint count)
+	{
+		TEMPASSERT(count == 4);
+		PushElement(VertexElement{ GL_INT_2_10_10_10_REV, count, GL_TRUE });
+	}
+
+	void PushElement(const VertexElement& element)
+	{
+		m_Elements.push_back(element);
+		m_Stride += element.GetSize();
+	}
 	
 	inline std::vector<VertexElement> GetElements() const { return m_Elements; };
 
@@ -0,0 +1,9 @@
+#pragma once
+
+// Where Bezier surface heights and normals are calculated
+enum BezierMode {
+	BM_CPU,				// tessellated on the CPU every tick, only height and slopes streamed to the GPU (BEZIER_STREAM)
+	BM_VertexShader,	// static (u, v) grid, only control points sent every tick, evaluated in Phong.shader with BEZIER_SURFACE
+	BM_TransformFeedback,	// evaluated on the GPU once per tick (BezierFeedback.shader) into a buffer every pass draws with BEZIER_STREAM
+	BM_Tessellation		// one patch of the 16 control points, tessellated on the GPU (BEZIER_PATCH), needs a 4.0 context
+};
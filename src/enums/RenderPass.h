@@ -0,0 +1,7 @@
+#pragma once
+
+// Highest bits of a RenderQueue sort key, passes are drawn in this order
+enum RenderPass {
+	RP_Opaque,		// front to back, so hidden fragments fail the depth test early
+	RP_Transparent	// back to front, blended over the opaque pass
+};